@@ -0,0 +1,142 @@
+/*
+ *     alias.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "alias.h"
+
+
+/*
+* Description - Builds an alias table by Vose's method. The weights are
+*               scaled to the mean of 1; columns below it get the rest of
+*               their height from a column above it, until all are full.
+*
+* Input  -      *t       - the table to init
+*               *weights - weight of each item
+*               n        - number of the items
+* Return -      On Success - 0, on Error -1
+*/
+int alias_init (alias_table* t, const double* weights, int n)
+{
+	double* scaled = NULL;
+	int* small = NULL;
+	int* large = NULL;
+	int small_num = 0, large_num = 0;
+	double sum = 0;
+	int i;
+
+	memset (t, 0, sizeof (alias_table));
+
+	for (i = 0; i < n; i++) {
+		if (weights[i] < 0) {
+			fprintf (stderr, "%s - error: negative weight of item %d.\n", __func__, i);
+			return -1;
+		}
+		sum += weights[i];
+	}
+
+	if (n <= 0 || sum <= 0) {
+		fprintf (stderr, "%s - error: no item with a positive weight.\n", __func__);
+		return -1;
+	}
+
+	t->n = n;
+	t->prob = (double *) calloc (n, sizeof (double));
+	t->alias = (int *) calloc (n, sizeof (int));
+	scaled = (double *) calloc (n, sizeof (double));
+	small = (int *) calloc (n, sizeof (int));
+	large = (int *) calloc (n, sizeof (int));
+
+	if (!t->prob || !t->alias || !scaled || !small || !large) {
+		fprintf (stderr, "%s - error: allocation of %d items failed.\n", __func__, n);
+		free (scaled);
+		free (small);
+		free (large);
+		alias_free (t);
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		scaled[i] = weights[i] * n / sum;
+
+		if (scaled[i] < 1.0) {
+			small[small_num++] = i;
+		} else {
+			large[large_num++] = i;
+		}
+	}
+
+	while (small_num && large_num) {
+		int s = small[--small_num];
+		int l = large[--large_num];
+
+		t->prob[s] = scaled[s];
+		t->alias[s] = l;
+
+		scaled[l] -= 1.0 - scaled[s];
+
+		if (scaled[l] < 1.0) {
+			small[small_num++] = l;
+		} else {
+			large[large_num++] = l;
+		}
+	}
+
+	/* the rest are full, up to rounding errors */
+	while (large_num) {
+		i = large[--large_num];
+		t->prob[i] = 1.0;
+		t->alias[i] = i;
+	}
+
+	while (small_num) {
+		i = small[--small_num];
+		t->prob[i] = 1.0;
+		t->alias[i] = i;
+	}
+
+	free (scaled);
+	free (small);
+	free (large);
+
+	return 0;
+}
+
+
+/*
+* Description - Releases the table
+*
+* Input  -      *t - the table
+*/
+void alias_free (alias_table* t)
+{
+	free (t->prob);
+	free (t->alias);
+	memset (t, 0, sizeof (alias_table));
+}
+
+
+/*
+* Description - Picks an item with the probability of its weight
+*
+* Input  -      *t   - the table
+*               *rng - random generator of the worker
+* Return -      Index of the item
+*/
+int alias_pick (const alias_table* t, rng_state* rng)
+{
+	double u = rng_double (rng) * t->n;
+	int column = (int) u;
+
+	if (column >= t->n) {
+		column = t->n - 1;
+	}
+
+	/* the fraction of u is the coin */
+	return (u - column) < t->prob[column] ? column : t->alias[column];
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
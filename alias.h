@@ -0,0 +1,35 @@
+/*
+ *     alias.h
+ *
+ */
+#ifndef ALIAS_H
+#define ALIAS_H
+
+#include "rng.h"
+
+/* Walker's alias table: picks one of <n> items with the given weights in
+   O(1), a random column and a biased coin.  */
+typedef struct alias_table {
+
+	/* Number of the items */
+	int n;
+
+	/* Probability to keep the column, per column */
+	double* prob;
+
+	/* Item taken instead, when the column is not kept */
+	int* alias;
+
+} alias_table;
+
+/* Builds the table from non-negative weights, at least one of them positive */
+int alias_init (alias_table* t, const double* weights, int n);
+
+/* Releases the table */
+void alias_free (alias_table* t);
+
+/* Picks an item */
+int alias_pick (const alias_table* t, rng_state* rng);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
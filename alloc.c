@@ -0,0 +1,94 @@
+/*
+ *     alloc.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <curl/curl.h>
+
+#include "alloc.h"
+
+/* Allocations by libcurl of the thread. Each worker counts its own, no
+   atomics are needed.  */
+static __thread unsigned long long allocs;
+
+/* forward declaration */
+static void* count_malloc (size_t size);
+static void count_free (void* ptr);
+static void* count_realloc (void* ptr, size_t size);
+static char* count_strdup (const char* str);
+static void* count_calloc (size_t nmemb, size_t size);
+
+
+/*
+* Description - Inits libcurl with the memory callbacks, that count the
+*               allocations of each thread. The request state of samk
+*               itself comes from the arenas and the slots of the workers,
+*               allocated before the run; what is left on the hot path
+*               is libcurl.
+*
+* Input  -      flags - flags of curl_global_init ()
+* Return -      On Success - 0, on Error -1
+*/
+int alloc_count_init (long flags)
+{
+	CURLcode res = curl_global_init_mem (flags, count_malloc, count_free,
+			count_realloc, count_strdup, count_calloc);
+
+	if (res != CURLE_OK) {
+		fprintf (stderr, "%s - error: curl_global_init_mem () failed, %s.\n",
+				__func__, curl_easy_strerror (res));
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Allocations made by libcurl in the calling thread
+*
+* Return -      The number of malloc, calloc, realloc and strdup calls
+*/
+unsigned long long alloc_count (void)
+{
+	return allocs;
+}
+
+
+static void* count_malloc (size_t size)
+{
+	allocs++;
+	return malloc (size);
+}
+
+
+static void count_free (void* ptr)
+{
+	free (ptr);
+}
+
+
+static void* count_realloc (void* ptr, size_t size)
+{
+	allocs++;
+	return realloc (ptr, size);
+}
+
+
+static char* count_strdup (const char* str)
+{
+	allocs++;
+	return strdup (str);
+}
+
+
+static void* count_calloc (size_t nmemb, size_t size)
+{
+	allocs++;
+	return calloc (nmemb, size);
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
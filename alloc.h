@@ -0,0 +1,20 @@
+/*
+ *     alloc.h
+ *
+ */
+#ifndef ALLOC_H
+#define ALLOC_H
+
+/* Tries of each handle of a worker, before its allocations are counted. The
+   first tries fill the connection and DNS caches and grow the buffers of
+   the handles; the steady state is after them.  */
+#define ALLOC_WARMUP_TRIES 4
+
+/* Inits libcurl with the allocation counting callbacks */
+int alloc_count_init (long flags);
+
+/* Allocations made by libcurl in the calling thread so far */
+unsigned long long alloc_count (void);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,112 @@
+/*
+ *     arena.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "arena.h"
+
+/* Allocations are kept 8 bytes aligned */
+#define ARENA_ALIGN(len) (((len) + 7) & ~((size_t) 7))
+
+
+/*
+* Description - Allocates the buffer of an arena
+*
+* Input  -      *a   - the arena to init
+*               size - size of the buffer
+* Return -      On Success - 0, on Error -1
+*/
+int arena_init (arena* a, size_t size)
+{
+	memset (a, 0, sizeof (arena));
+
+	if (!(a->base = (char *) malloc (size))) {
+		fprintf (stderr, "%s - error: allocation of %zu bytes failed.\n",
+				__func__, size);
+		return -1;
+	}
+
+	a->size = size;
+
+	return 0;
+}
+
+
+/*
+* Description - Releases the buffer of an arena
+*
+* Input  -      *a - the arena
+*/
+void arena_free (arena* a)
+{
+	free (a->base);
+	memset (a, 0, sizeof (arena));
+}
+
+
+/*
+* Description - Releases everything allocated from the arena at once
+*
+* Input  -      *a - the arena
+*/
+void arena_reset (arena* a)
+{
+	a->used = 0;
+}
+
+
+/*
+* Description - Allocates from the arena
+*
+* Input  -      *a  - the arena
+*               len - bytes to allocate
+* Return -      The memory, NULL when the arena is full
+*/
+void* arena_alloc (arena* a, size_t len)
+{
+	void* ptr;
+
+	if (len > a->size - a->used) {
+		return NULL;
+	}
+
+	ptr = a->base + a->used;
+	a->used += ARENA_ALIGN (len);
+
+	if (a->used > a->size) {
+		a->used = a->size;
+	}
+
+	return ptr;
+}
+
+
+/*
+* Description - Renders a string into the arena
+*
+* Input  -      *a      - the arena
+*               *format - printf format of the string
+* Return -      The string, NULL when the arena is full
+*/
+char* arena_printf (arena* a, const char* format, ...)
+{
+	size_t room = a->size - a->used;
+	va_list ap;
+	int len;
+
+	va_start (ap, format);
+	len = vsnprintf (a->base + a->used, room, format, ap);
+	va_end (ap);
+
+	if (len < 0 || (size_t) len >= room) {
+		return NULL;
+	}
+
+	return (char *) arena_alloc (a, (size_t) len + 1);
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
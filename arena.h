@@ -0,0 +1,43 @@
+/*
+ *     arena.h
+ *
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* A bump allocator over a buffer allocated once. Everything allocated from
+   it is released at once by arena_reset (), so a handle renders the
+   strings of a try without a malloc and forgets them before the next one.  */
+typedef struct arena {
+
+	/* The buffer */
+	char* base;
+
+	/* Size of the buffer */
+	size_t size;
+
+	/* Bytes allocated since the last reset */
+	size_t used;
+
+} arena;
+
+/* Allocates the buffer of <size> bytes */
+int arena_init (arena* a, size_t size);
+
+/* Releases the buffer */
+void arena_free (arena* a);
+
+/* Releases everything allocated from the arena, the buffer is kept */
+void arena_reset (arena* a);
+
+/* Allocates <len> bytes, 8 bytes aligned, NULL when the arena is full */
+void* arena_alloc (arena* a, size_t len);
+
+/* Renders a string, printf-like, NULL when the arena is full */
+char* arena_printf (arena* a, const char* format, ...)
+	__attribute__ ((format (printf, 2, 3)));
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
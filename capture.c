@@ -0,0 +1,217 @@
+/*
+ *     capture.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <linux/limits.h> /* PATH_MAX */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "capture.h"
+
+/* Records are kept 8 bytes aligned */
+#define CAPTURE_ALIGN(len) (((len) + 7) & ~((uint64_t) 7))
+
+/* forward declaration */
+static void append_record (capture_ring* cr, capture_type type, uint64_t try_id,
+		long status, const void* data, size_t len);
+
+
+/*
+* Description - Creates the ring file of a worker, allocates its blocks and
+*               maps it. The responses are copied from the libcurl buffers
+*               straight into the mapped pages, there is no write () per
+*               chunk; the kernel writes the pages back in the background.
+*
+* Input  -      *cr       - the ring to open
+*               *dir      - directory of the file
+*               *run_name - name of the run, "samk" when empty
+*               worker    - id of the worker
+*               size_mb   - size of the ring, MB
+*               sample    - one try out of <sample> is captured
+* Return -      On Success - 0, on Error -1
+*/
+int capture_ring_open (capture_ring* cr, const char* dir, const char* run_name,
+		int worker, long size_mb, long sample)
+{
+	char filename[PATH_MAX + 1];
+	int fd;
+	int err;
+
+	memset (cr, 0, sizeof (capture_ring));
+
+	snprintf (filename, sizeof (filename), "%s/%s.%d.capture",
+			dir && dir[0] ? dir : ".", run_name && run_name[0] ? run_name : "samk",
+			worker);
+
+	cr->size = (uint64_t) size_mb << 20;
+	cr->map_size = CAPTURE_FILE_HEADER_SIZE + cr->size;
+	cr->worker = worker;
+	cr->sample = sample > 0 ? sample : 1;
+
+	if ((fd = open (filename, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1) {
+		fprintf (stderr, "%s - error: open() failed to open for writing \"%s\", errno %d.\n",
+				__func__, filename, errno);
+		return -1;
+	}
+
+	/* the blocks are allocated now, not on a page fault during the run */
+	if ((err = posix_fallocate (fd, 0, (off_t) cr->map_size))) {
+		fprintf (stderr, "%s - error: posix_fallocate() of %zu bytes for \"%s\" failed, errno %d.\n",
+				__func__, cr->map_size, filename, err);
+		close (fd);
+		return -1;
+	}
+
+	cr->map = (unsigned char *) mmap (NULL, cr->map_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, 0);
+	close (fd);
+
+	if (cr->map == MAP_FAILED) {
+		fprintf (stderr, "%s - error: mmap() of \"%s\" failed, errno %d.\n",
+				__func__, filename, errno);
+		cr->map = NULL;
+		return -1;
+	}
+
+	cr->header = (capture_file_header *) cr->map;
+	cr->ring = cr->map + CAPTURE_FILE_HEADER_SIZE;
+
+	memcpy (cr->header->magic, CAPTURE_FILE_MAGIC, sizeof (cr->header->magic));
+	cr->header->size = cr->size;
+	cr->header->head = 0;
+	cr->header->wraps = 0;
+
+	return 0;
+}
+
+
+/*
+* Description - Writes the ring file back and unmaps it
+*
+* Input  -      *cr - the ring
+*/
+void capture_ring_close (capture_ring* cr)
+{
+	if (cr->map) {
+		msync (cr->map, cr->map_size, MS_ASYNC);
+		munmap (cr->map, cr->map_size);
+	}
+
+	memset (cr, 0, sizeof (capture_ring));
+}
+
+
+/*
+* Description - Starts a try of the handle, it is captured, when sampled
+*
+* Input  -      *cs    - capture state of the handle
+*               try_id - id of the try, unique in the worker
+*               headers - flag; whether the response headers are captured
+*               bodies  - flag; whether the response bodies are captured
+*/
+void capture_begin (capture_stream* cs, uint64_t try_id, int headers, int bodies)
+{
+	cs->try_id = try_id;
+	cs->headers = headers;
+	cs->bodies = bodies;
+	cs->active = cs->ring && (headers || bodies) &&
+		(try_id % (uint64_t) cs->ring->sample) == 0;
+}
+
+
+/*
+* Description - Appends a header line or a body chunk of the current try,
+*               when the try is sampled and the type is captured
+*
+* Input  -      *cs   - capture state of the handle
+*               type  - CAPTURE_HEADER or CAPTURE_BODY
+*               *data - the data as handed over by libcurl
+*               len   - length of the data
+*/
+void capture_write (capture_stream* cs, capture_type type, const void* data, size_t len)
+{
+	if (!cs->active ||
+			(type == CAPTURE_HEADER && !cs->headers) ||
+			(type == CAPTURE_BODY && !cs->bodies)) {
+		return;
+	}
+
+	append_record (cs->ring, type, cs->try_id, 0, data, len);
+}
+
+
+/*
+* Description - Ends the current try, recording its HTTP status
+*
+* Input  -      *cs    - capture state of the handle
+*               status - HTTP status of the response
+*/
+void capture_end (capture_stream* cs, long status)
+{
+	if (cs->active) {
+		append_record (cs->ring, CAPTURE_END, cs->try_id, status, NULL, 0);
+		cs->active = 0;
+	}
+}
+
+
+/*
+* Description - Copies a record into the ring. The oldest records are
+*               overwritten, when the ring is full. Data larger than the ring
+*               is truncated.
+*
+* Input  -      *cr    - the ring
+*               type   - type of the record
+*               try_id - id of the try
+*               status - HTTP status, END records only
+*               *data  - the data, may be NULL for no data
+*               len    - length of the data
+*/
+static void append_record (capture_ring* cr, capture_type type, uint64_t try_id,
+		long status, const void* data, size_t len)
+{
+	uint64_t head = cr->header->head;
+	uint64_t need;
+	capture_record* rec;
+
+	if (len > cr->size - sizeof (capture_record)) {
+		len = cr->size - sizeof (capture_record);
+	}
+
+	need = sizeof (capture_record) + CAPTURE_ALIGN (len);
+
+	if (head + need > cr->size) {
+		if (cr->size - head >= sizeof (capture_record)) {
+			rec = (capture_record *) (cr->ring + head);
+			memset (rec, 0, sizeof (capture_record));
+			rec->magic = CAPTURE_RECORD_MAGIC;
+			rec->type = CAPTURE_WRAP;
+			rec->worker = (uint16_t) cr->worker;
+		}
+		head = 0;
+		cr->header->wraps++;
+	}
+
+	rec = (capture_record *) (cr->ring + head);
+	rec->magic = CAPTURE_RECORD_MAGIC;
+	rec->type = (uint16_t) type;
+	rec->worker = (uint16_t) cr->worker;
+	rec->len = (uint32_t) len;
+	rec->status = (uint32_t) status;
+	rec->try_id = try_id;
+
+	if (len) {
+		memcpy (rec + 1, data, len);
+	}
+
+	cr->header->head = head + need;
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,107 @@
+/*
+ *     capture.h
+ *
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Default size of the ring file of a worker, MB */
+#define CAPTURE_RING_SIZE_DEFAULT 16
+
+/* Size of the file header, the records start at this offset */
+#define CAPTURE_FILE_HEADER_SIZE 4096
+
+#define CAPTURE_FILE_MAGIC "SAMKCAP1"
+#define CAPTURE_RECORD_MAGIC 0x43524543
+
+/* Types of the capture records */
+typedef enum capture_type {
+	CAPTURE_HEADER = 1,     /* a response header line */
+	CAPTURE_BODY,           /* a chunk of a response body */
+	CAPTURE_END,            /* end of a try, carries the HTTP status */
+	CAPTURE_WRAP,           /* the rest of the ring is unused, go to its start */
+} capture_type;
+
+/* Header of the ring file, at offset 0. The ring of records follows at
+   CAPTURE_FILE_HEADER_SIZE. <head> is updated after each record, so the
+   newest record ends there and the oldest one follows it (after <wraps>
+   is non-zero). Less than a record header left before the end of the ring
+   means the same as a CAPTURE_WRAP record.  */
+typedef struct capture_file_header {
+	char magic[8];
+	uint64_t size;
+	uint64_t head;
+	uint64_t wraps;
+} capture_file_header;
+
+/* A record in the ring, followed by <len> bytes of data padded to 8 bytes */
+typedef struct capture_record {
+	uint32_t magic;
+	uint16_t type;
+	uint16_t worker;
+	uint32_t len;
+	uint32_t status;
+	uint64_t try_id;
+} capture_record;
+
+/* Memory-mapped ring file of a worker, <dir>/<run-name>.<worker>.capture */
+typedef struct capture_ring {
+
+	/* The mapped file, header and ring */
+	unsigned char* map;
+	size_t map_size;
+
+	/* The file header in the map */
+	capture_file_header* header;
+
+	/* The ring of records in the map */
+	unsigned char* ring;
+	uint64_t size;
+
+	/* Id of the worker owning the ring */
+	int worker;
+
+	/* One try out of <sample> is captured */
+	long sample;
+
+} capture_ring;
+
+/* Capture state of a handle for its current try */
+typedef struct capture_stream {
+
+	/* Ring of the worker, NULL when nothing is captured */
+	capture_ring* ring;
+
+	/* Flag; whether the current try is sampled */
+	int active;
+
+	/* Id of the current try */
+	uint64_t try_id;
+
+	/* What is captured of the current try, as set for its url */
+	int headers;
+	int bodies;
+
+} capture_stream;
+
+/* Creates and maps the ring file of a worker */
+int capture_ring_open (capture_ring* cr, const char* dir, const char* run_name,
+		int worker, long size_mb, long sample);
+
+/* Syncs and unmaps the ring file */
+void capture_ring_close (capture_ring* cr);
+
+/* Starts a try, decides whether it is sampled */
+void capture_begin (capture_stream* cs, uint64_t try_id, int headers, int bodies);
+
+/* Appends response data of the current try */
+void capture_write (capture_stream* cs, capture_type type, const void* data, size_t len);
+
+/* Ends the current try with its HTTP status */
+void capture_end (capture_stream* cs, long status);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
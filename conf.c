@@ -3,8 +3,10 @@
 */
 #include <stdio.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include <sys/stat.h>
 
@@ -27,10 +29,54 @@ int detailed_logging = 0;
 /* Name of the configuration file */
 char config_file[PATH_MAX + 1];
 
+/* Name of the trace file to convert */
+char dump_file[PATH_MAX + 1];
+
+/* Flag, whether to convert the trace to JSON lines */
+int dump_json = 0;
+
+/* Params of the built-in server, run instead of a test with --serve */
+serve_conf serve_config = { .threads = 1, .body_size = 64 };
+
+/* Options of the built-in server, they have no short forms */
+enum {
+    OPT_SERVE = 256,
+    OPT_SERVE_THREADS,
+    OPT_BODY_SIZE,
+    OPT_DELAY,
+    OPT_STATUS,
+};
+
+static const struct option long_options [] = {
+    {"serve", required_argument, NULL, OPT_SERVE},
+    {"serve-threads", required_argument, NULL, OPT_SERVE_THREADS},
+    {"body-size", required_argument, NULL, OPT_BODY_SIZE},
+    {"delay", required_argument, NULL, OPT_DELAY},
+    {"status", required_argument, NULL, OPT_STATUS},
+    {NULL, 0, NULL, 0}
+};
+
 
 /* forward declaration */
 
 static int clients_num_tries_parser (client_context* const cctx, char *const value);
+static int concurrency_parser (client_context* const cctx, char *const value);
+static int threads_parser (client_context* const cctx, char *const value);
+static int rate_parser (client_context* const cctx, char *const value);
+static int arrival_parser (client_context* const cctx, char *const value);
+static int cpu_affinity_parser (client_context* const cctx, char *const value);
+static int share_caches_parser (client_context* const cctx, char *const value);
+static int hist_precision_parser (client_context* const cctx, char *const value);
+static int max_error_rate_parser (client_context* const cctx, char *const value);
+static int compare_http_versions_parser (client_context* const cctx, char *const value);
+static int max_streams_parser (client_context* const cctx, char *const value);
+static int parse_http_version (const char* value, size_t len, long* version);
+static int dns_cache_ttl_parser (client_context* const cctx, char *const value);
+static int run_time_parser (client_context* const cctx, char *const value);
+static int keep_samples_parser (client_context* const cctx, char *const value);
+static int report_interval_parser (client_context* const cctx, char *const value);
+static int trace_parser (client_context* const cctx, char *const value);
+static int perf_counters_parser (client_context* const cctx, char *const value);
 static int timer_tcp_conn_setup_parser (client_context *const ctx , char*const value);
 //static int timer_url_completion_parser (client_context* const cctx, char *const value);
 static int add_param_to_ctx (char*const input, size_t input_length, client_context *ctx);
@@ -42,13 +88,47 @@ static int pre_parser (char** ptr, size_t* len);
 
 /* url related */
 static int keep_alive_parser (client_context* const cctx, char *const value); 
+static int http_version_parser (client_context* const cctx, char *const value);
+static int dns_mode_parser (client_context* const cctx, char *const value);
+static int resolve_parser (client_context* const cctx, char *const value);
+static int ip_resolve_parser (client_context* const cctx, char *const value);
 static int url_parser (client_context* const cctx, char *const value); 
 static int user_agent_parser (client_context* const cctx, char *const value); 
 static int run_name_parser (client_context* const cctx, char *const value); 
+static int try_id_header_parser (client_context* const cctx, char *const value);
+static int seed_parser (client_context* const cctx, char *const value);
 static int max_num_headers_parser (client_context* const cctx, char *const value);
 static int request_type_parser (client_context* const cctx, char *const value);
+static int body_file_parser (client_context* const cctx, char *const value);
 //static int fresh_connect_parser (client_context* const cctx, char *const value); 
 
+/* log related */
+static int log_resp_headers_parser (client_context* const cctx, char *const value);
+static int log_resp_body_parser (client_context* const cctx, char *const value);
+static int log_dir_parser (client_context* const cctx, char *const value);
+static int log_sample_parser (client_context* const cctx, char *const value);
+static int log_ring_size_parser (client_context* const cctx, char *const value);
+
+/* validation related */
+static int expect_length_parser (client_context* const cctx, char *const value);
+static int expect_crc32c_parser (client_context* const cctx, char *const value);
+static int expect_contains_parser (client_context* const cctx, char *const value);
+static int expect_regex_parser (client_context* const cctx, char *const value);
+static int expect_window_parser (client_context* const cctx, char *const value);
+static validate_spec* url_validate_spec (client_context* const cctx);
+
+/* workload related */
+static int weight_parser (client_context* const cctx, char *const value);
+static url_context* add_url (client_context* const cctx);
+static url_context* current_url (client_context* const cctx);
+static int finish_urls (client_context* const cctx);
+static int finish_dns_mode (client_context* const cctx, url_context* const url);
+static int build_url_headers (url_context* const url);
+static size_t url_arena_size (url_context* const url);
+static int url_uses_key (url_context* const url);
+static int keyspace_parser (client_context* const cctx, char *const value);
+static int key_dist_parser (client_context* const cctx, char *const value);
+
 
 typedef int (*fparser) (client_context* const cctx, char* const value);
 
@@ -65,23 +145,57 @@ static const tag_parser_pair tag_map [] = {
 	/* GENERAL SECTION */
 	{"RUN_NAME", run_name_parser},
 	{"NUM_TRIES", clients_num_tries_parser},
+	{"CONCURRENCY", concurrency_parser},
+	{"THREADS", threads_parser},
+	{"RATE", rate_parser},
+	{"ARRIVAL", arrival_parser},
+	{"CPU_AFFINITY", cpu_affinity_parser},
+	{"SHARE_CACHES", share_caches_parser},
+	{"RUN_TIME", run_time_parser},
+	{"KEEP_SAMPLES", keep_samples_parser},
+	{"REPORT_INTERVAL", report_interval_parser},
+	{"TRACE", trace_parser},
+	{"PERF_COUNTERS", perf_counters_parser},
+	{"HIST_PRECISION", hist_precision_parser},
+	{"MAX_ERROR_RATE", max_error_rate_parser},
+	{"COMPARE_HTTP_VERSIONS", compare_http_versions_parser},
+	{"MAX_STREAMS_PER_CONN", max_streams_parser},
+	{"DNS_CACHE_TTL", dns_cache_ttl_parser},
 	{"USER_AGENT", user_agent_parser},
+	{"TRY_ID_HEADER", try_id_header_parser},
+	{"SEED", seed_parser},
+	{"KEYSPACE", keyspace_parser},
+	{"KEY_DIST", key_dist_parser},
 
 	/* URL SECTION  */
 	{"URL", url_parser},
+	{"WEIGHT", weight_parser},
 	{"HEADER", header_parser},
 	{"MAX_NUM_HEADERS", max_num_headers_parser},
 	{"REQUEST_TYPE", request_type_parser},
+	{"BODY_FILE", body_file_parser},
 	{"KEEP_ALIVE", keep_alive_parser},
+	{"HTTP_VERSION", http_version_parser},
+	{"DNS_MODE", dns_mode_parser},
+	{"RESOLVE", resolve_parser},
+	{"IP_RESOLVE", ip_resolve_parser},
+
+	{"EXPECT_LENGTH", expect_length_parser},
+	{"EXPECT_CRC32C", expect_crc32c_parser},
+	{"EXPECT_CONTAINS", expect_contains_parser},
+	{"EXPECT_REGEX", expect_regex_parser},
+	{"EXPECT_WINDOW", expect_window_parser},
 
 	{"TIMER_TCP_CONN_SETUP", timer_tcp_conn_setup_parser},
 	/* {"TIMER_URL_COMPLETION", timer_url_completion_parser}, */
-	/* {"TIMER_AFTER_URL_FETCH_SLEEP", timer_after_url_sleep_parser}, */
 
 	/* LOG SECTION  */
 	/* {"DUMP_STATS", dump_stats_parser}, */
-	/* {"LOG_RESP_HEADERS", log_resp_headers_parser},*/
-	/* {"LOG_RESP_BODY", log_resp_body_parser}, */
+	{"LOG_RESPONSE_HEADERS", log_resp_headers_parser},
+	{"LOG_RESPONSE_BODY", log_resp_body_parser},
+	{"LOG_DIR", log_dir_parser},
+	{"LOG_SAMPLE", log_sample_parser},
+	{"LOG_RING_SIZE", log_ring_size_parser},
 
 	{NULL, 0}
 };
@@ -303,10 +417,32 @@ pre_parser (char** ptr, size_t* len) {
         }
     }
 
-    /* If not quotted strings, cut the value on the first white space */
-    if (!value_end)
+    /* If not quotted strings, cut the value on the first white space. A
+       comma separated list may have white spaces around its commas.  */
+    if (!value_end) {
         value_end = skip_non_ws (value_start, len);
 
+        while (value_end) {
+            char* next = eat_ws (value_end, len);
+
+            if (!next || (value_end[-1] != ',' && *next != ','))
+                break;
+
+            value_end = skip_non_ws (next, len);
+        }
+
+        /* nothing but a ';' is expected after the value */
+        if (value_end) {
+            char* rest = value_end + strspn (value_end, " \t\r\n;");
+
+            if (*rest) {
+                fprintf (stderr, "%s - warning: \"%.*s\" after the value is ignored, "
+                        "quote a value with white spaces.\n", __func__,
+                        (int) strcspn (rest, "\r\n"), rest);
+            }
+        }
+    }
+
     if (value_end) {
         *value_end = '\0';
     }
@@ -350,253 +486,1524 @@ clients_num_tries_parser (client_context* const ctx,
 
 
 static int 
-timer_tcp_conn_setup_parser (client_context *const ctx ,
-                             char*const value)
+concurrency_parser (client_context* const ctx, 
+                    char *const value) 
 {
-    long timer = atol(value);
+    ctx->concurrency = atol(value);
 
-    if (timer <= 0 || timer > 50) {
-        fprintf(stderr, 
-                "%s error: input of the timer is expected  to be from " 
-                "1 up to 50 seconds.\n", __func__);
+    if (ctx->concurrency < 0) {
+        fprintf (stderr, "%s - error: concurrency (%ld) is not valid\n", 
+                __func__, ctx->concurrency);
         return -1;
     }
 
-    ctx->url.connect_timeout = timer;
-
     return 0;
 }
 
 
 static int 
-keep_alive_parser (client_context* const ctx, 
-                   char* const value)
+threads_parser (client_context* const ctx, 
+                char *const value) 
 {
-    long bol = atol(value);
+    ctx->threads = atol(value);
 
-    if (bol < 0 || bol > 1) {
-        fprintf(stderr,
-                "%s error: boolean input 0 or 1 is expected\n", __func__);
+    if (ctx->threads < 0 || ctx->threads > WORKERS_MAX_NUM) {
+        fprintf (stderr, "%s - error: number of threads (%ld) is expected "
+                "to be from 0 up to %d\n", __func__, ctx->threads, WORKERS_MAX_NUM);
         return -1;
     }
 
-    ctx->url.fresh_connect = bol;
-
     return 0;
 }
 
 
-int header_parser (client_context* const ctx, char* const value) {
-
-    size_t hdr_len;
+static int 
+rate_parser (client_context* const ctx, 
+             char *const value) 
+{
+    ctx->rate = atof(value);
 
-    if (!value || !(hdr_len = strlen (value))) {
-        fprintf (stderr, "%s - error: wrong input.\n", __func__);
+    if (ctx->rate < 0) {
+        fprintf (stderr, "%s - error: rate (%f) is not valid\n", 
+                __func__, ctx->rate);
         return -1;
     }
 
-    const char colon = ':';
+    return 0;
+}
 
-    if (!strchr (value, colon)) {
-        fprintf (stderr, 
-                "%s - error: HTTP protocol requires \"%c\" colomn symbol" 
-                " in HTTP headers.\n", __func__, colon);
-        return -1;
-    }
 
-    if (ctx->url.custom_http_hdrs_num >= CUSTOM_HDRS_MAX_NUM) {
-        fprintf (stderr, 
-                "%s - error: number of custom HTTP headers is limited to %d.\n", 
-                __func__, CUSTOM_HDRS_MAX_NUM);
+static int 
+arrival_parser (client_context* const ctx, 
+                char *const value) 
+{
+    size_t len = strcspn (value, "\"; \t");
+
+    if (len == 8 && !strncmp (value, "constant", len)) {
+        ctx->arrival = ARRIVAL_CONSTANT;
+    } else if (len == 7 && !strncmp (value, "poisson", len)) {
+        ctx->arrival = ARRIVAL_POISSON;
+    } else {
+        fprintf (stderr, "%s - error: arrival \"%.*s\" is not one of "
+                "constant, poisson\n", __func__, (int) len, value);
         return -1;
     }
 
-    if (!(ctx->url.custom_http_hdrs = curl_slist_append (ctx->url.custom_http_hdrs, value))) {
-        fprintf (stderr, "%s - error: failed to append the header \"%s\"\n", 
-                __func__, value);
+    return 0;
+}
+
+
+static int 
+cpu_affinity_parser (client_context* const ctx, 
+                     char *const value) 
+{
+    long bol = atol(value);
+
+    if (bol < 0 || bol > 1) {
+        fprintf(stderr,
+                "%s error: boolean input 0 or 1 is expected\n", __func__);
         return -1;
     }
 
-    ctx->url.custom_http_hdrs_num++;
+    ctx->cpu_affinity = bol;
 
     return 0;
 }
 
 
 static int 
-url_parser (client_context* const ctx, char* const value) {
+share_caches_parser (client_context* const ctx, 
+                     char *const value) 
+{
+    long bol = atol(value);
 
-    size_t url_length = 0;	
+    if (bol < 0 || bol > 1) {
+        fprintf(stderr,
+                "%s error: boolean input 0 or 1 is expected\n", __func__);
+        return -1;
+    }
 
-    url_length = strlen(value);
+    ctx->share_caches = bol;
 
-    if (!(url_length = strlen (value))) {
-        fprintf (stderr, "%s - error: empty url \"%s\"\n", __func__, value);
-        return -1;
-    } else if (! (ctx->url.url_str = (char *) calloc (url_length +1, sizeof (char)))) {
-        fprintf (stderr, "%s - error: allocation failed for url string \"%s\"\n",
-                __func__, value);
+    return 0;
+}
+
+
+static int 
+run_time_parser (client_context* const ctx, 
+                 char *const value) 
+{
+    long run_time = atol(value);
+
+    if (run_time < 0) {
+        fprintf (stderr, "%s - error: run time (%ld) is not valid\n", 
+                __func__, run_time);
         return -1;
     }
 
-    strncpy(ctx->url.url_str, value, url_length);
+    ctx->run_time = (unsigned long) run_time;
 
     return 0;
 }
 
 
 static int 
-user_agent_parser (client_context* const ctx, char* const value) {
+keep_samples_parser (client_context* const ctx, 
+                     char *const value) 
+{
+    long bol = atol(value);
 
-    if (strlen (value) <= 0) {
-        fprintf(stderr, "%s - warning: empty USER_AGENT "
-                "\"%s\", taking the defaults\n", __func__, value);
-        return 0;
+    if (bol < 0 || bol > 1) {
+        fprintf(stderr,
+                "%s error: boolean input 0 or 1 is expected\n", __func__);
+        return -1;
     }
 
-    strncpy (ctx->user_agent, value, sizeof(ctx->user_agent) - 1);
+    ctx->keep_samples = bol;
 
     return 0;
 }
 
 
 static int 
-max_num_headers_parser (client_context* const ctx, char* const value) {
+trace_parser (client_context* const ctx, 
+              char *const value) 
+{
+    long bol = atol(value);
+
+    if (bol < 0 || bol > 1) {
+        fprintf(stderr,
+                "%s error: boolean input 0 or 1 is expected\n", __func__);
+        return -1;
+    }
 
-    //strncpy (ctx->url.custom_http_hdrs_num, value, CUSTOM_HDRS_MAX_NUM);
+    ctx->trace = bol;
 
     return 0;
 }
 
 
 static int 
-request_type_parser (client_context* const rctx, char* const value) {
-    
-    //strncpy (ctx->run_name, value, RUN_NAME_SIZE);
-    
+perf_counters_parser (client_context* const ctx, 
+              char *const value) 
+{
+    long bol = atol(value);
+
+    if (bol < 0 || bol > 1) {
+        fprintf(stderr,
+                "%s error: boolean input 0 or 1 is expected\n", __func__);
+        return -1;
+    }
+
+    ctx->perf_counters = bol;
+
     return 0;
 }
 
 
-/* At the moment the command line arguments are ignored 
- * except the read file option -f
- *
- * All the config paramemters are read from the config file */
-int parse_command_line (int argc, char *argv []) {
-
-    int rget_opt = 0;
+static int 
+report_interval_parser (client_context* const ctx, 
+                        char *const value) 
+{
+    long interval = atol(value);
 
-    while ((rget_opt = getopt (argc, argv, "c:n:hf:v")) != EOF) {
-        switch (rget_opt) 
-        {
-            case 'c': /* Connection establishment timeout */
-                if (!optarg || (connect_timeout = atoi (optarg)) <= 0) {
-                    fprintf (stderr, "%s error: -c option should be a positive number in seconds.\n", __func__);
-                    return -1;
-                }
-                break;
+    if (interval < 0) {
+        fprintf (stderr, "%s - error: report interval (%ld) is not valid\n", 
+                __func__, interval);
+        return -1;
+    }
 
-            case 'n': /* Number of times to run */
-                if (!optarg || (num_run = atoi (optarg)) <= 0) {
-                    fprintf (stderr, "%s error: -n option should be a positive number.\n", __func__);
-                    return -1;
-                }
-                break;
+    ctx->report_interval = (unsigned long) interval;
 
-            case 'h': /* Help */
-                print_help ();
-                exit (0);
+    return 0;
+}
 
-            case 'f': /* Configuration file */
-                if (optarg)
-                    strcpy(config_file, optarg);
-                else {
-                    fprintf (stderr, "%s error: -f option should be followed by a filename.\n", __func__);
-                    return -1;
-                }
-                break;
 
-            case 'v': /* Accumulate verbosity */
-                verbose_logging += 1; 
-                break;
+static int 
+hist_precision_parser (client_context* const ctx, 
+                       char *const value) 
+{
+    long precision = atol(value);
 
-            default: 
-                fprintf (stderr, "%s error: not supported option\n", __func__);
-                print_help ();
-                return -1;
-        }
+    if (precision < 1 || precision > HIST_PRECISION_MAX) {
+        fprintf (stderr, "%s - error: histogram precision is expected to be "
+                "from 1 up to %d significant digits\n", __func__, HIST_PRECISION_MAX);
+        return -1;
     }
 
-    if (optind < argc) {
+    ctx->hist_precision = (int) precision;
 
-        fprintf (stderr, "%s error: non-option argv-elements: ", __func__);
+    return 0;
+}
 
-        while (optind < argc)
-            fprintf (stderr, "%s ", argv[optind++]);
 
-        fprintf (stderr, "\n");
-        print_help ();
+static int 
+max_error_rate_parser (client_context* const ctx, 
+                       char *const value) 
+{
+    ctx->max_error_rate = atof(value);
 
+    if (ctx->max_error_rate < 0 || ctx->max_error_rate > 100) {
+        fprintf (stderr, "%s - error: error rate (%f) is expected to be a percent, "
+                "from 0 up to 100\n", __func__, ctx->max_error_rate);
         return -1;
     }
 
     return 0;
 }
 
-/*
-* Description - Parses configuration file and fills the client contexts struct 
-* Input       - *filename  - name of the configuration file to parse.
-* Input       - *ctx       - client contexts to be filled on parsing
-* Return      - On Success - 0, on Error -1
-*/
-int 
-parse_config_file(char* const filename, client_context *ctx) 
+
+static int 
+timer_tcp_conn_setup_parser (client_context *const ctx ,
+                             char*const value)
 {
-    char fgets_buff[1024*8];
-    FILE* fp;
-    struct stat statbuf;
-    int line_no;
+    long timer = atol(value);
 
-    /* Check, if the configuration file exists. */
-    if (stat (filename, &statbuf) == -1) {
-        fprintf (stderr,
-                "%s - failed to find configuration file \"%s\" with errno %d.\n"
-                ,__func__, filename, errno);
-        print_help();
+    if (timer <= 0 || timer > 50) {
+        fprintf(stderr, 
+                "%s error: input of the timer is expected  to be from " 
+                "1 up to 50 seconds.\n", __func__);
         return -1;
     }
 
-    if (!(fp = fopen (filename, "r"))) {
-        fprintf (stderr, 
-                "%s - fopen() failed to open for reading filename \"%s\", errno %d.\n", 
-                __func__, filename, errno);
+    if (!current_url (ctx)) {
         return -1;
     }
 
-    while (fgets (fgets_buff, sizeof (fgets_buff) - 1, fp)) {
-        size_t string_len = 0;
-        line_no++;
-        if ((string_len = strlen (fgets_buff))) {
-            /* Line may be commented out by '#'.*/
-            if (fgets_buff[0] == '#') {
-                continue;
-            }
+    ctx->url->connect_timeout = timer;
 
-            if (add_param_to_ctx (fgets_buff, string_len, ctx) == -1) {
-                fprintf (stderr,
-                        "%s - error: add_param_to_ctx () failed processing buffer \"%s\"\n",
-                        __func__, fgets_buff);
-                fclose (fp);
-                return -1 ;
-            }
-        }
+    return 0;
+}
+
+
+static int 
+keep_alive_parser (client_context* const ctx, 
+                   char* const value)
+{
+    long bol = atol(value);
+
+    if (bol < 0 || bol > 1) {
+        fprintf(stderr,
+                "%s error: boolean input 0 or 1 is expected\n", __func__);
+        return -1;
     }
 
-    fclose (fp);
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    /* keep-alive means re-using the connections instead of fresh ones */
+    ctx->url->fresh_connect = !bol;
 
     return 0;
 }
 
+
+/* HTTP versions of the config, as asked from libcurl */
+static const struct {
+    const char* name;
+    long version;
+} http_versions [] = {
+    {"1.0", CURL_HTTP_VERSION_1_0},
+    {"1.1", CURL_HTTP_VERSION_1_1},
+    {"2", CURL_HTTP_VERSION_2TLS},
+    {"h2c-prior-knowledge", CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE},
+};
+
+#define HTTP_VERSIONS_NUM (sizeof (http_versions) / sizeof (http_versions[0]))
+
+
+/*
+* Description - Parses an HTTP version: 1.0, 1.1, 2 (negotiated by TLS ALPN,
+*               1.1 without TLS) or h2c-prior-knowledge (HTTP/2 without TLS
+*               and without an upgrade)
+*
+* Input  -      *value - the version, not terminated
+*               len    - its length
+* Output -      *version - CURL_HTTP_VERSION_*
+* Return -      On Success - 0, on Error -1
+*/
+static int 
+parse_http_version (const char* value, size_t len, long* version)
+{
+    size_t i;
+
+    for (i = 0; i < HTTP_VERSIONS_NUM; i++) {
+        if (strlen (http_versions[i].name) == len &&
+                !strncmp (value, http_versions[i].name, len)) {
+            *version = http_versions[i].version;
+            return 0;
+        }
+    }
+
+    fprintf (stderr, "%s - error: HTTP version \"%.*s\" is not one of "
+            "1.0, 1.1, 2, h2c-prior-knowledge\n", __func__, (int) len, value);
+    return -1;
+}
+
+
+/*
+* Description - Name of an HTTP version, the one of the config; also of a
+*               version negotiated by libcurl
+*
+* Input  -      version - CURL_HTTP_VERSION_*
+* Return -      The name
+*/
+const char* 
+http_version_name (long version)
+{
+    size_t i;
+
+    for (i = 0; i < HTTP_VERSIONS_NUM; i++) {
+        if (http_versions[i].version == version) {
+            return http_versions[i].name;
+        }
+    }
+
+    switch (version) {
+    case CURL_HTTP_VERSION_NONE:
+        return "none";
+    case CURL_HTTP_VERSION_2_0:
+        return "2";
+    case CURL_HTTP_VERSION_3:
+        return "3";
+    default:
+        return "unknown";
+    }
+}
+
+
+static int 
+http_version_parser (client_context* const ctx, 
+                     char* const value)
+{
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    return parse_http_version (value, strcspn (value, "\"; \t"), &ctx->url->http_version);
+}
+
+
+static int 
+compare_http_versions_parser (client_context* const ctx, 
+                              char* const value)
+{
+    size_t len = strcspn (value, "\";");
+    size_t pos = 0, n;
+
+    ctx->compare_versions_num = 0;
+
+    /* a comma separated list, spaces are allowed around the versions */
+    while (pos < len) {
+        pos += strspn (value + pos, " \t");
+        if (pos == len) {
+            break;
+        }
+
+        n = strcspn (value + pos, ",\"; \t");
+
+        if (ctx->compare_versions_num == HTTP_VERSIONS_MAX) {
+            fprintf (stderr, "%s - error: more than %d HTTP versions to compare\n",
+                    __func__, HTTP_VERSIONS_MAX);
+            return -1;
+        }
+
+        if (parse_http_version (value + pos, n,
+                    &ctx->compare_versions[ctx->compare_versions_num++]) == -1) {
+            return -1;
+        }
+
+        pos += n;
+        pos += strspn (value + pos, " \t");
+
+        if (value[pos] == ',') {
+            pos++;
+        } else if (pos < len) {
+            fprintf (stderr, "%s - error: \"%.*s\" is not expected after an HTTP "
+                    "version, versions are separated by commas\n", __func__,
+                    (int) (len - pos), value + pos);
+            return -1;
+        }
+    }
+
+    if (!ctx->compare_versions_num) {
+        fprintf (stderr, "%s - error: no HTTP version to compare\n", __func__);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int 
+max_streams_parser (client_context* const ctx, 
+                    char* const value)
+{
+    ctx->max_streams = atol(value);
+
+    if (ctx->max_streams < 1) {
+        fprintf (stderr, "%s - error: streams per connection (%ld) are expected "
+                "to be 1 or more\n", __func__, ctx->max_streams);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int 
+dns_cache_ttl_parser (client_context* const ctx, 
+                      char* const value)
+{
+    ctx->dns_cache_ttl = atol(value);
+
+    if (ctx->dns_cache_ttl < 1 && ctx->dns_cache_ttl != -1) {
+        fprintf (stderr, "%s - error: DNS cache ttl (%ld) is expected to be "
+                "1 or more secs, or -1 for the whole run\n", __func__, ctx->dns_cache_ttl);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* DNS modes of the config, by DNS_MODE_* */
+static const char* const dns_modes [DNS_MODES_NUM] = {
+    "default", "cold", "cached", "pinned"
+};
+
+
+/*
+* Description - Name of a DNS mode, the one of the config
+*
+* Input  -      mode - DNS_MODE_*
+* Return -      The name
+*/
+const char* 
+dns_mode_name (int mode)
+{
+    return mode >= 0 && mode < DNS_MODES_NUM ? dns_modes[mode] : "unknown";
+}
+
+
+static int 
+dns_mode_parser (client_context* const ctx, 
+                 char* const value)
+{
+    size_t len = strcspn (value, "\"; \t");
+    int i;
+
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    for (i = DNS_MODE_COLD; i < DNS_MODES_NUM; i++) {
+        if (strlen (dns_modes[i]) == len && !strncmp (value, dns_modes[i], len)) {
+            ctx->url->dns_mode = i;
+            return 0;
+        }
+    }
+
+    fprintf (stderr, "%s - error: DNS mode \"%.*s\" is not one of "
+            "cold, cached, pinned\n", __func__, (int) len, value);
+    return -1;
+}
+
+
+/*
+* Description - Parses a RESOLVE tag, host:port:addr[,addr], as taken by
+*               CURLOPT_RESOLVE. The tag may be repeated for more hosts.
+*
+* Input  -      *ctx   - the client context being parsed
+*               *value - the entry
+* Return -      On Success - 0, on Error -1
+*/
+static int 
+resolve_parser (client_context* const ctx, 
+                char* const value)
+{
+    struct curl_slist* resolve;
+    char* host_end;
+    char* port_end;
+
+    value[strcspn (value, "\"; \t")] = '\0';
+
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    /* the address may be an IPv6 one, only the host and the port are checked */
+    if (!(host_end = strchr (value, ':')) || host_end == value ||
+            !(port_end = strchr (host_end + 1, ':')) || port_end == host_end + 1 ||
+            !port_end[1]) {
+        fprintf (stderr, "%s - error: RESOLVE (%s) is expected as host:port:addr[,addr]\n",
+                __func__, value);
+        return -1;
+    }
+
+    if (!(resolve = curl_slist_append (ctx->url->resolve, value))) {
+        fprintf (stderr, "%s - error: curl_slist_append () failed.\n", __func__);
+        return -1;
+    }
+
+    ctx->url->resolve = resolve;
+
+    return 0;
+}
+
+
+static int 
+ip_resolve_parser (client_context* const ctx, 
+                   char* const value)
+{
+    size_t len = strcspn (value, "\"; \t");
+
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    if (len == 2 && !strncmp (value, "v4", len)) {
+        ctx->url->ip_resolve = CURL_IPRESOLVE_V4;
+    } else if (len == 2 && !strncmp (value, "v6", len)) {
+        ctx->url->ip_resolve = CURL_IPRESOLVE_V6;
+    } else if (len == 3 && !strncmp (value, "any", len)) {
+        ctx->url->ip_resolve = CURL_IPRESOLVE_WHATEVER;
+    } else {
+        fprintf (stderr, "%s - error: IP_RESOLVE \"%.*s\" is not one of v4, v6, any\n",
+                __func__, (int) len, value);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int header_parser (client_context* const ctx, char* const value) {
+
+    size_t hdr_len;
+
+    if (!value || !(hdr_len = strlen (value))) {
+        fprintf (stderr, "%s - error: wrong input.\n", __func__);
+        return -1;
+    }
+
+    const char colon = ':';
+
+    if (!strchr (value, colon)) {
+        fprintf (stderr, 
+                "%s - error: HTTP protocol requires \"%c\" colomn symbol" 
+                " in HTTP headers.\n", __func__, colon);
+        return -1;
+    }
+
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    if (ctx->url->custom_http_hdrs_num >= CUSTOM_HDRS_MAX_NUM) {
+        fprintf (stderr, 
+                "%s - error: number of custom HTTP headers is limited to %d.\n", 
+                __func__, CUSTOM_HDRS_MAX_NUM);
+        return -1;
+    }
+
+    if (!(ctx->url->custom_http_hdrs = curl_slist_append (ctx->url->custom_http_hdrs, value))) {
+        fprintf (stderr, "%s - error: failed to append the header \"%s\"\n", 
+                __func__, value);
+        return -1;
+    }
+
+    ctx->url->custom_http_hdrs_num++;
+
+    return 0;
+}
+
+
+static int 
+url_parser (client_context* const ctx, char* const value) {
+
+    size_t url_length = 0;	
+
+    url_length = strlen(value);
+
+    if (!(url_length = strlen (value))) {
+        fprintf (stderr, "%s - error: empty url \"%s\"\n", __func__, value);
+        return -1;
+    }
+
+    /* each URL starts a new url of the workload, unless the url tags
+       preceding the first URL have started it already */
+    if ((!ctx->url || ctx->url->url_str) && !add_url (ctx)) {
+        return -1;
+    }
+
+    if (! (ctx->url->url_str = (char *) calloc (url_length +1, sizeof (char)))) {
+        fprintf (stderr, "%s - error: allocation failed for url string \"%s\"\n",
+                __func__, value);
+        return -1;
+    }
+
+    strncpy(ctx->url->url_str, value, url_length);
+
+    return 0;
+}
+
+
+static int 
+user_agent_parser (client_context* const ctx, char* const value) {
+
+    if (strlen (value) <= 0) {
+        fprintf(stderr, "%s - warning: empty USER_AGENT "
+                "\"%s\", taking the defaults\n", __func__, value);
+        return 0;
+    }
+
+    strncpy (ctx->user_agent, value, sizeof(ctx->user_agent) - 1);
+
+    return 0;
+}
+
+
+static int 
+log_resp_headers_parser (client_context* const ctx, char* const value) {
+
+    long bol = atol(value);
+
+    if (bol < 0 || bol > 1) {
+        fprintf(stderr,
+                "%s error: boolean input 0 or 1 is expected\n", __func__);
+        return -1;
+    }
+
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    ctx->url->log_resp_headers = bol;
+
+    return 0;
+}
+
+
+static int 
+log_resp_body_parser (client_context* const ctx, char* const value) {
+
+    long bol = atol(value);
+
+    if (bol < 0 || bol > 1) {
+        fprintf(stderr,
+                "%s error: boolean input 0 or 1 is expected\n", __func__);
+        return -1;
+    }
+
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    ctx->url->log_resp_bodies = bol;
+
+    return 0;
+}
+
+
+static int 
+log_dir_parser (client_context* const ctx, char* const value) {
+
+    if (!strlen (value)) {
+        fprintf (stderr, "%s - error: empty LOG_DIR\n", __func__);
+        return -1;
+    }
+
+    free (ctx->dir_log);
+
+    if (!(ctx->dir_log = strdup (value))) {
+        fprintf (stderr, "%s - error: allocation failed for LOG_DIR \"%s\"\n",
+                __func__, value);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int 
+try_id_header_parser (client_context* const ctx, char* const value) {
+
+    size_t len = strcspn (value, "\":; \t");
+
+    if (!len) {
+        fprintf (stderr, "%s - error: empty TRY_ID_HEADER\n", __func__);
+        return -1;
+    }
+    value[len] = '\0';
+
+    free (ctx->try_id_header);
+
+    if (!(ctx->try_id_header = strdup (value))) {
+        fprintf (stderr, "%s - error: allocation failed for TRY_ID_HEADER \"%s\"\n",
+                __func__, value);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int 
+seed_parser (client_context* const ctx, char* const value) {
+
+    char* end = NULL;
+    unsigned long long seed = strtoull (value, &end, 0);
+
+    if (!end || end == value || (*end && *end != ';')) {
+        fprintf (stderr, "%s - error: SEED \"%s\" is not a number\n", __func__, value);
+        return -1;
+    }
+
+    ctx->seed = (uint64_t) seed;
+
+    return 0;
+}
+
+
+static int 
+log_sample_parser (client_context* const ctx, char* const value) {
+
+    long sample = atol(value);
+
+    if (sample < 1) {
+        fprintf (stderr, "%s - error: LOG_SAMPLE (%ld) should be 1 or more\n", 
+                __func__, sample);
+        return -1;
+    }
+
+    ctx->log_sample = sample;
+
+    return 0;
+}
+
+
+static int 
+log_ring_size_parser (client_context* const ctx, char* const value) {
+
+    long size = atol(value);
+
+    if (size < 1 || size > 4096) {
+        fprintf (stderr, "%s - error: LOG_RING_SIZE (%ld) should be from 1 to 4096 MB\n", 
+                __func__, size);
+        return -1;
+    }
+
+    ctx->log_ring_size = size;
+
+    return 0;
+}
+
+
+/* The expectations of the url, allocated on the first EXPECT_ tag */
+static validate_spec* 
+url_validate_spec (client_context* const ctx) {
+
+    if (!current_url (ctx)) {
+        return NULL;
+    }
+
+    if (!ctx->url->validate) {
+        ctx->url->validate = validate_spec_new ();
+    }
+
+    return ctx->url->validate;
+}
+
+
+static int 
+expect_length_parser (client_context* const ctx, char* const value) {
+
+    validate_spec* spec;
+    long long length = atoll(value);
+
+    if (length < 0) {
+        fprintf (stderr, "%s - error: EXPECT_LENGTH (%lld) is not valid\n", 
+                __func__, length);
+        return -1;
+    }
+
+    if (!(spec = url_validate_spec (ctx))) {
+        return -1;
+    }
+
+    spec->length = length;
+
+    return 0;
+}
+
+
+static int 
+expect_crc32c_parser (client_context* const ctx, char* const value) {
+
+    validate_spec* spec;
+    char* end = NULL;
+    unsigned long crc = strtoul (value, &end, 16);
+
+    /* the line may end with a ';', like the other numeric tags */
+    if (!end || end == value || (*end && *end != ';') || crc > 0xffffffffUL) {
+        fprintf (stderr, "%s - error: EXPECT_CRC32C \"%s\" is not a 32 bit hex number\n", 
+                __func__, value);
+        return -1;
+    }
+
+    if (!(spec = url_validate_spec (ctx))) {
+        return -1;
+    }
+
+    spec->check_crc = 1;
+    spec->crc32c = (uint32_t) crc;
+
+    return 0;
+}
+
+
+static int 
+expect_contains_parser (client_context* const ctx, char* const value) {
+
+    validate_spec* spec;
+    size_t len = strlen (value);
+
+    if (len > VALIDATE_CONTAINS_MAX) {
+        fprintf (stderr, "%s - error: EXPECT_CONTAINS is longer than %d\n", 
+                __func__, VALIDATE_CONTAINS_MAX);
+        return -1;
+    }
+
+    if (!(spec = url_validate_spec (ctx))) {
+        return -1;
+    }
+
+    memcpy (spec->contains, value, len + 1);
+    spec->contains_len = len;
+
+    return 0;
+}
+
+
+static int 
+expect_regex_parser (client_context* const ctx, char* const value) {
+
+    validate_spec* spec;
+    int err;
+
+    if (!(spec = url_validate_spec (ctx))) {
+        return -1;
+    }
+
+    if (spec->check_regex) {
+        regfree (&spec->regex);
+        spec->check_regex = 0;
+    }
+
+    if ((err = regcomp (&spec->regex, value, REG_EXTENDED | REG_NOSUB | REG_NEWLINE))) {
+        char errbuf[128];
+
+        regerror (err, &spec->regex, errbuf, sizeof (errbuf));
+        fprintf (stderr, "%s - error: EXPECT_REGEX \"%s\": %s\n", 
+                __func__, value, errbuf);
+        return -1;
+    }
+
+    spec->check_regex = 1;
+
+    return 0;
+}
+
+
+static int 
+expect_window_parser (client_context* const ctx, char* const value) {
+
+    validate_spec* spec;
+    long window = atol(value);
+
+    if (window < 1) {
+        fprintf (stderr, "%s - error: EXPECT_WINDOW (%ld) should be positive\n", 
+                __func__, window);
+        return -1;
+    }
+
+    if (!(spec = url_validate_spec (ctx))) {
+        return -1;
+    }
+
+    spec->window = (size_t) window;
+
+    return 0;
+}
+
+
+static int 
+weight_parser (client_context* const ctx, char* const value) {
+
+    double weight = atof(value);
+
+    if (weight <= 0) {
+        fprintf (stderr, "%s - error: WEIGHT (%s) should be positive\n", 
+                __func__, value);
+        return -1;
+    }
+
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    ctx->url->weight = weight;
+
+    return 0;
+}
+
+
+/*
+* Description - Appends a new url to the workload and makes it the current one
+*
+* Input  -      *ctx - the client context being parsed
+* Return -      On Success - the new url, on Error NULL
+*/
+static url_context* 
+add_url (client_context* const ctx) {
+
+    if (ctx->urls_num == ctx->urls_size) {
+        int size = ctx->urls_size ? ctx->urls_size * 2 : 8;
+        url_context* urls;
+
+        if (!(urls = (url_context *) realloc (ctx->urls, size * sizeof (url_context)))) {
+            fprintf (stderr, "%s - error: allocation of %d urls failed.\n", __func__, size);
+            return NULL;
+        }
+
+        ctx->urls = urls;
+        ctx->urls_size = size;
+    }
+
+    ctx->url = &ctx->urls[ctx->urls_num];
+    memset (ctx->url, 0, sizeof (url_context));
+    ctx->url->id = ctx->urls_num++;
+    ctx->url->weight = 1.0;
+    ctx->url->ip_resolve = CURL_IPRESOLVE_V4;
+
+    return ctx->url;
+}
+
+
+/*
+* Description - The url the url tags apply to, the last one started by a URL
+*               tag. A url is started, when the tag precedes the first URL.
+*
+* Input  -      *ctx - the client context being parsed
+* Return -      On Success - the url, on Error NULL
+*/
+static url_context* 
+current_url (client_context* const ctx) {
+
+    return ctx->url ? ctx->url : add_url (ctx);
+}
+
+
+/*
+* Description - Checks the urls of the workload, when the config file is
+*               parsed, and builds the picker of the urls by their weights
+*
+* Input  -      *ctx - the parsed client context
+* Return -      On Success - 0, on Error -1
+*/
+static int 
+finish_urls (client_context* const ctx) {
+
+    double* weights;
+    int i;
+
+    ctx->arena_size = ARENA_SIZE_MIN;
+
+    if (!ctx->urls_num) {
+        fprintf (stderr, "%s - error: no URL is configured.\n", __func__);
+        return -1;
+    }
+
+    if (ctx->keyspace.keys && keyspace_init (&ctx->keyspace) == -1) {
+        return -1;
+    }
+
+    for (i = 0; i < ctx->urls_num; i++) {
+        url_context* url = &ctx->urls[i];
+
+        if (!url->url_str) {
+            fprintf (stderr, "%s - error: url tags without a URL.\n", __func__);
+            return -1;
+        }
+
+        if (tmpl_compile (&url->url_tmpl, url->url_str, strlen (url->url_str),
+                    TMPL_STRICT) == -1 || build_url_headers (url) == -1) {
+            return -1;
+        }
+
+        if (!ctx->keyspace.keys && url_uses_key (url)) {
+            fprintf (stderr, "%s - error: {{key}} of \"%s\" needs a KEYSPACE.\n",
+                    __func__, url->url_str);
+            return -1;
+        }
+
+        if (url_arena_size (url) > ctx->arena_size) {
+            ctx->arena_size = url_arena_size (url);
+        }
+
+        if (url->payloads_num && url->req_type != HTTP_REQ_TYPE_POST &&
+                url->req_type != HTTP_REQ_TYPE_PUT) {
+            fprintf (stderr, "%s - error: BODY_FILE of \"%s\" needs REQUEST_TYPE "
+                    "POST or PUT.\n", __func__, url->url_str);
+            return -1;
+        }
+
+        if (finish_dns_mode (ctx, url) == -1) {
+            return -1;
+        }
+    }
+
+    ctx->url = &ctx->urls[0];
+
+    if (ctx->urls_num == 1) {
+        return 0;
+    }
+
+    if (!(weights = (double *) calloc (ctx->urls_num, sizeof (double)))) {
+        fprintf (stderr, "%s - error: allocation failed.\n", __func__);
+        return -1;
+    }
+
+    for (i = 0; i < ctx->urls_num; i++) {
+        weights[i] = ctx->urls[i].weight;
+    }
+
+    if (alias_init (&ctx->url_picker, weights, ctx->urls_num) == -1) {
+        free (weights);
+        return -1;
+    }
+
+    free (weights);
+
+    return 0;
+}
+
+
+/*
+* Description - Settles the DNS mode of a url. RESOLVE entries pin the names,
+*               unless another mode is asked for; a url without a mode keeps
+*               the names cached, when the caches are shared, and looks them
+*               up for each connection otherwise.
+*
+* Input  -      *ctx - the parsed client context
+*               *url - the url
+* Return -      On Success - 0, on Error -1
+*/
+static int 
+finish_dns_mode (client_context* const ctx, url_context* const url) {
+
+    if (url->dns_mode == DNS_MODE_PINNED && !url->resolve) {
+        fprintf (stderr, "%s - error: DNS_MODE pinned of \"%s\" needs RESOLVE.\n",
+                __func__, url->url_str);
+        return -1;
+    }
+
+    if (url->dns_mode == DNS_MODE_DEFAULT) {
+        if (url->resolve) {
+            url->dns_mode = DNS_MODE_PINNED;
+        } else {
+            url->dns_mode = ctx->share_caches ? DNS_MODE_CACHED : DNS_MODE_COLD;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+* Description - Builds the headers of a url, as parsed. The headers with
+*               placeholders are compiled, to be rendered per try; the rest
+*               is built into a single block, sent by reference.
+*
+* Input  -      *url - the url
+* Return -      On Success - 0, on Error -1
+*/
+static int 
+build_url_headers (url_context* const url) {
+
+    struct curl_slist* fixed = NULL;
+    struct curl_slist* item;
+    struct curl_slist* tmp;
+    int ret = -1;
+
+    for (item = url->custom_http_hdrs; item; item = item->next) {
+
+        if (strstr (item->data, "{{")) {
+            tmpl* tmpls = (tmpl *) realloc (url->header_tmpls,
+                    (url->header_tmpls_num + 1) * sizeof (tmpl));
+
+            if (!tmpls) {
+                fprintf (stderr, "%s - error: allocation failed.\n", __func__);
+                goto out;
+            }
+            url->header_tmpls = tmpls;
+
+            if (tmpl_compile (&url->header_tmpls[url->header_tmpls_num], item->data,
+                        strlen (item->data), TMPL_STRICT | TMPL_COPY) == -1) {
+                goto out;
+            }
+            url->header_tmpls_num++;
+
+        } else {
+            if (!(tmp = curl_slist_append (fixed, item->data))) {
+                fprintf (stderr, "%s - error: allocation failed.\n", __func__);
+                goto out;
+            }
+            fixed = tmp;
+        }
+    }
+
+    if (url->header_tmpls_num >= HEADER_VARS_MAX) {
+        fprintf (stderr, "%s - error: more than %d HEADER tags with placeholders.\n",
+                __func__, HEADER_VARS_MAX - 1);
+        goto out;
+    }
+
+    if (header_set_build (&url->headers, fixed) == -1) {
+        goto out;
+    }
+
+    curl_slist_free_all (url->custom_http_hdrs);
+    url->custom_http_hdrs = NULL;
+    ret = 0;
+
+out:
+    curl_slist_free_all (fixed);
+
+    return ret;
+}
+
+
+/*
+* Description - Size of the arena, a try of the url renders its strings into.
+*               Each rendering may take up to 8 bytes more for the alignment.
+*               The rest of ARENA_SIZE_MIN is left for TRY_ID_HEADER.
+*
+* Input  -      *url - the url
+* Return -      The size
+*/
+static size_t 
+url_arena_size (url_context* const url) {
+
+    size_t size = ARENA_SIZE_MIN;
+    size_t body = 0;
+    int i;
+
+    if (tmpl_dynamic (&url->url_tmpl)) {
+        size += url->url_tmpl.max_len + 8;
+    }
+
+    for (i = 0; i < url->header_tmpls_num; i++) {
+        size += url->header_tmpls[i].max_len + 8;
+    }
+
+    for (i = 0; i < url->payloads_num; i++) {
+        if (tmpl_dynamic (&url->payloads[i].body) && url->payloads[i].body.max_len > body) {
+            body = url->payloads[i].body.max_len;
+        }
+    }
+
+    return size + (body ? body + 8 : 0);
+}
+
+
+/*
+* Description - Tells, whether the url, its headers or bodies have a {{key}}
+*
+* Input  -      *url - the url, compiled
+* Return -      1 when they have, 0 otherwise
+*/
+static int 
+url_uses_key (url_context* const url) {
+
+    int i;
+
+    if (tmpl_uses (&url->url_tmpl, TMPL_KEY)) {
+        return 1;
+    }
+
+    for (i = 0; i < url->header_tmpls_num; i++) {
+        if (tmpl_uses (&url->header_tmpls[i], TMPL_KEY)) {
+            return 1;
+        }
+    }
+
+    for (i = 0; i < url->payloads_num; i++) {
+        if (tmpl_uses (&url->payloads[i].body, TMPL_KEY)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int 
+keyspace_parser (client_context* const ctx, char* const value) {
+
+    char* end = NULL;
+    unsigned long long keys = strtoull (value, &end, 0);
+
+    if (!end || end == value || (*end && *end != ';') || !keys) {
+        fprintf (stderr, "%s - error: KEYSPACE \"%s\" should be a positive number\n",
+                __func__, value);
+        return -1;
+    }
+
+    ctx->keyspace.keys = (uint64_t) keys;
+
+    return 0;
+}
+
+
+static int 
+key_dist_parser (client_context* const ctx, char* const value) {
+
+    keyspace* ks = &ctx->keyspace;
+    size_t len = strcspn (value, "\"; \t");
+    double a = 0, b = 0;
+    int n = 0;
+
+    value[len] = '\0';
+
+    if (!strcasecmp (value, "uniform")) {
+        ks->dist = KEY_DIST_UNIFORM;
+    } else if (!strcasecmp (value, "zipf")) {
+        ks->dist = KEY_DIST_ZIPF;
+        ks->s = 0.99;
+    } else if (sscanf (value, "zipf:%lf%n", &a, &n) == 1 && (size_t) n == len) {
+        ks->dist = KEY_DIST_ZIPF;
+        ks->s = a;
+    } else if (!strcasecmp (value, "hotspot")) {
+        ks->dist = KEY_DIST_HOTSPOT;
+        ks->hot_fraction = 0.2;
+        ks->hot_share = 0.8;
+    } else if (sscanf (value, "hotspot:%lf:%lf%n", &a, &b, &n) == 2 && (size_t) n == len) {
+        ks->dist = KEY_DIST_HOTSPOT;
+        ks->hot_fraction = a;
+        ks->hot_share = b;
+    } else {
+        fprintf (stderr, "%s - error: KEY_DIST \"%s\" is not one of uniform, "
+                "zipf[:<s>] or hotspot[:<keys>:<tries>]\n", __func__, value);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int 
+max_num_headers_parser (client_context* const ctx, char* const value) {
+
+    //strncpy (ctx->url->custom_http_hdrs_num, value, CUSTOM_HDRS_MAX_NUM);
+
+    return 0;
+}
+
+
+static int 
+request_type_parser (client_context* const ctx, char* const value) {
+
+    static const char* const methods [HTTP_REQ_TYPE_LAST] = {
+        NULL, "GET", "POST", "PUT", "HEAD", "DELETE"
+    };
+    size_t len = strcspn (value, "\"; \t");
+    int i;
+
+    for (i = HTTP_REQ_TYPE_GET; i < HTTP_REQ_TYPE_LAST; i++) {
+        if (len == strlen (methods[i]) && !strncasecmp (value, methods[i], len)) {
+            break;
+        }
+    }
+
+    if (i == HTTP_REQ_TYPE_LAST) {
+        fprintf (stderr, "%s - error: REQUEST_TYPE \"%s\" is not one of GET, POST, "
+                "PUT, HEAD or DELETE\n", __func__, value);
+        return -1;
+    }
+
+    if (!current_url (ctx)) {
+        return -1;
+    }
+
+    ctx->url->req_type = (size_t) i;
+
+    return 0;
+}
+
+
+static int 
+body_file_parser (client_context* const ctx, char* const value) {
+
+    size_t len = strcspn (value, "\";");
+    payload* payloads;
+    url_context* url;
+
+    if (!len) {
+        fprintf (stderr, "%s - error: empty BODY_FILE\n", __func__);
+        return -1;
+    }
+    value[len] = '\0';
+
+    if (!(url = current_url (ctx))) {
+        return -1;
+    }
+
+    if (!(payloads = (payload *) realloc (url->payloads,
+                    (url->payloads_num + 1) * sizeof (payload)))) {
+        fprintf (stderr, "%s - error: allocation failed for BODY_FILE \"%s\"\n",
+                __func__, value);
+        return -1;
+    }
+    url->payloads = payloads;
+
+    if (payload_map (&url->payloads[url->payloads_num], value) == -1) {
+        return -1;
+    }
+    url->payloads_num++;
+
+    return 0;
+}
+
+
+/* At the moment the command line arguments are ignored 
+ * except the read file option -f
+ *
+ * All the config paramemters are read from the config file */
+int parse_command_line (int argc, char *argv []) {
+
+    int rget_opt = 0;
+
+    while ((rget_opt = getopt_long (argc, argv, "c:n:hf:vD:j", long_options, NULL)) != EOF) {
+        switch (rget_opt) 
+        {
+            case 'c': /* Connection establishment timeout */
+                if (!optarg || (connect_timeout = atoi (optarg)) <= 0) {
+                    fprintf (stderr, "%s error: -c option should be a positive number in seconds.\n", __func__);
+                    return -1;
+                }
+                break;
+
+            case 'n': /* Number of times to run */
+                if (!optarg || (num_run = atoi (optarg)) <= 0) {
+                    fprintf (stderr, "%s error: -n option should be a positive number.\n", __func__);
+                    return -1;
+                }
+                break;
+
+            case 'h': /* Help */
+                print_help ();
+                exit (0);
+
+            case 'f': /* Configuration file */
+                if (optarg)
+                    strcpy(config_file, optarg);
+                else {
+                    fprintf (stderr, "%s error: -f option should be followed by a filename.\n", __func__);
+                    return -1;
+                }
+                break;
+
+            case 'v': /* Accumulate verbosity */
+                verbose_logging += 1; 
+                break;
+
+            case 'D': /* Trace file to convert */
+                if (optarg && strlen (optarg) <= PATH_MAX)
+                    strcpy(dump_file, optarg);
+                else {
+                    fprintf (stderr, "%s error: -D option should be followed by a trace filename.\n", __func__);
+                    return -1;
+                }
+                break;
+
+            case 'j': /* Convert the trace to JSON lines */
+                dump_json = 1;
+                break;
+
+            case OPT_SERVE: /* Port of the built-in server */
+                if ((serve_config.port = atoi (optarg)) <= 0 || serve_config.port > 65535) {
+                    fprintf (stderr, "%s error: --serve option should be a port number.\n", __func__);
+                    return -1;
+                }
+                break;
+
+            case OPT_SERVE_THREADS: /* Epoll threads of the server */
+                if ((serve_config.threads = atoi (optarg)) <= 0) {
+                    fprintf (stderr, "%s error: --serve-threads option should be a positive number.\n", __func__);
+                    return -1;
+                }
+                break;
+
+            case OPT_BODY_SIZE: /* Size of the response bodies of the server */
+                if (atol (optarg) < 0) {
+                    fprintf (stderr, "%s error: --body-size option should be a number of bytes.\n", __func__);
+                    return -1;
+                }
+                serve_config.body_size = (size_t) atol (optarg);
+                break;
+
+            case OPT_DELAY: /* Delay distribution of the server responses */
+                if (serve_parse_delay (&serve_config, optarg) == -1) {
+                    return -1;
+                }
+                break;
+
+            case OPT_STATUS: /* Status mix of the server responses */
+                if (serve_parse_status (&serve_config, optarg) == -1) {
+                    return -1;
+                }
+                break;
+
+            default: 
+                fprintf (stderr, "%s error: not supported option\n", __func__);
+                print_help ();
+                return -1;
+        }
+    }
+
+    if (optind < argc) {
+
+        fprintf (stderr, "%s error: non-option argv-elements: ", __func__);
+
+        while (optind < argc)
+            fprintf (stderr, "%s ", argv[optind++]);
+
+        fprintf (stderr, "\n");
+        print_help ();
+
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+* Description - Parses configuration file and fills the client contexts struct 
+* Input       - *filename  - name of the configuration file to parse.
+* Input       - *ctx       - client contexts to be filled on parsing
+* Return      - On Success - 0, on Error -1
+*/
+int 
+parse_config_file(char* const filename, client_context *ctx) 
+{
+    char fgets_buff[1024*8];
+    FILE* fp;
+    struct stat statbuf;
+    int line_no;
+
+    /* Check, if the configuration file exists. */
+    if (stat (filename, &statbuf) == -1) {
+        fprintf (stderr,
+                "%s - failed to find configuration file \"%s\" with errno %d.\n"
+                ,__func__, filename, errno);
+        print_help();
+        return -1;
+    }
+
+    if (!(fp = fopen (filename, "r"))) {
+        fprintf (stderr, 
+                "%s - fopen() failed to open for reading filename \"%s\", errno %d.\n", 
+                __func__, filename, errno);
+        return -1;
+    }
+
+    while (fgets (fgets_buff, sizeof (fgets_buff) - 1, fp)) {
+        size_t string_len = 0;
+        line_no++;
+        if ((string_len = strlen (fgets_buff))) {
+            /* Line may be commented out by '#'.*/
+            if (fgets_buff[0] == '#') {
+                continue;
+            }
+
+            if (add_param_to_ctx (fgets_buff, string_len, ctx) == -1) {
+                fprintf (stderr,
+                        "%s - error: add_param_to_ctx () failed processing buffer \"%s\"\n",
+                        __func__, fgets_buff);
+                fclose (fp);
+                return -1 ;
+            }
+        }
+    }
+
+    fclose (fp);
+
+    return finish_urls (ctx);
+}
+
 /* Print usage */
 void print_help () {
 
@@ -607,6 +2014,13 @@ void print_help () {
   fprintf (stderr, " -c[onnection establishment timeout, seconds]\n");
   fprintf (stderr, " -d[etailed logging; outputs to logfile headers and bodies of requests/responses.]\n");
   fprintf (stderr, " -v[erbose output to the logfiles; includes info about headers sent/received]\n");
+  fprintf (stderr, " -D <trace file> converts a trace, written with TRACE = 1, to CSV on stdout and exits\n");
+  fprintf (stderr, " -j with -D, converts to JSON lines instead of CSV\n");
+  fprintf (stderr, " --serve <port> runs the built-in HTTP/1.1 server on 127.0.0.1 instead of a test, until Ctrl-C\n");
+  fprintf (stderr, "   --serve-threads <n> epoll threads of the server, 1 by default\n");
+  fprintf (stderr, "   --body-size <bytes> size of the response bodies, 64 by default\n");
+  fprintf (stderr, "   --delay none|const:<usec>|uniform:<low>-<high>|exp:<mean> delay of the responses\n");
+  fprintf (stderr, "   --status <status>:<weight>[,...] status mix of the responses, e.g. 200:99,503:1\n");
   fprintf (stderr, "\n");
 
   fprintf (stderr, "For examples of configuration files please, look at custom-headers.conf file in current dir \n");
@@ -10,9 +10,30 @@
 #include <curl/curl.h>
 
 #include "url.h"
+#include "stats.h"
+#include "rng.h"
+#include "capture.h"
+#include "validate.h"
+#include "alias.h"
+#include "payload.h"
+#include "arena.h"
+#include "keyspace.h"
+#include "server.h"
 
 #define RUN_NAME_SIZE 64
 
+/* Upper limit of the THREADS configuration param */
+#define WORKERS_MAX_NUM 256
+
+/* Smallest arena of a handle, the renderings of the urls are added to it */
+#define ARENA_SIZE_MIN 4096
+
+/* Most HTTP versions of COMPARE_HTTP_VERSIONS */
+#define HTTP_VERSIONS_MAX 4
+
+/* Tries of a worker, the failed share of is checked against MAX_ERROR_RATE */
+#define ERROR_RATE_WINDOW 100
+
 
 /* configuration parameter, from the command-line. Number of times to run  */
 extern int num_run;
@@ -30,6 +51,15 @@ extern int verbose_logging;
 /* Name of the configuration file.  */
 extern char config_file[PATH_MAX + 1];
 
+/* Name of the trace file to convert, instead of running.  */
+extern char dump_file[PATH_MAX + 1];
+
+/* Flag; whether the trace is converted to JSON lines instead of CSV.  */
+extern int dump_json;
+
+/* Params of the built-in server; serve_config.port is set by --serve.  */
+extern serve_conf serve_config;
+
 
 /* HTTP requests: GET, POST and PUT.  */
 typedef enum req_type {
@@ -45,16 +75,83 @@ typedef enum req_type {
 
 } req_type;
 
+/* Distributions of the request inter-arrival times, when a RATE is set */
+typedef enum arrival_type {
+	ARRIVAL_CONSTANT = 0,
+	ARRIVAL_POISSON,
+} arrival_type;
+
 /*Time info and the result info of the run*/
 typedef struct client_stats {
 	curl_off_t total_time;
 	curl_off_t namelookup_time;
 	curl_off_t connect_time;
+	/* TLS handshake completed, zero without TLS or on a reused connection */
+	curl_off_t appconnect_time;
+	/* About to send the request */
+	curl_off_t pretransfer_time;
 	curl_off_t start_transfer_time;
+	/* All the redirection steps before the final transfer */
+	curl_off_t redirect_time;
+	/* Time from the intended send to the completion. With a RATE it includes
+	   the time the request has waited for a free slot.  */
+	curl_off_t response_time;
+	curl_off_t redirect_count;
+	/* Bytes of the request and the response bodies */
+	curl_off_t size_upload;
+	curl_off_t size_download;
+	/* Average speeds of the transfer, bytes/sec */
+	curl_off_t speed_upload;
+	curl_off_t speed_download;
+	/* Bytes of all the received headers */
+	curl_off_t header_size;
+	/* Nsec samk took to set the handle up for the try, its own cost */
+	curl_off_t setup_time;
+	/* Index of the url fetched by the try */
+	int url_id;
+	/* Rank of the key of the try in the KEYSPACE, zero for none */
+	uint64_t key_rank;
+	/* New connections made for the transfer, zero when a cached one was reused */
+	long int num_connects;
 	long int resp_code;
-	char server_ip [16];
+	/* HTTP version of the response, CURL_HTTP_VERSION_*, zero for none */
+	long http_version;
+	/* DNS_MODE_* of the url, its names were resolved by */
+	int dns_mode;
+	/* Ip of the server, v4 or v6, empty when not connected */
+	char server_ip [STATS_IP_SIZE];
+	/* Flag; the body of a successful response is not as expected */
+	int bad_body;
+	/* Usec since the start of the run, when the try was to be sent */
+	long long send_time;
+	/* CURLcode of the transfer */
+	long int curl_code;
 } client_stats;
 
+/* State of the response callbacks of a handle, for its current try */
+typedef struct response_ctx {
+	/* Capture of the response headers and body to the ring of the worker */
+	capture_stream capture;
+	/* Validation of the response body against the expected content */
+	validate_state validate;
+	/* The url the handle is set up for, NULL for none */
+	url_context* url;
+	/* Upload of the request body of a PUT */
+	payload_reader upload;
+	/* Tries of the handle, for taking the request bodies in turn */
+	long bodies_sent;
+	/* Variable headers of the current try */
+	header_scratch headers;
+	/* Strings rendered for the current try, reset before the next one */
+	arena arena;
+	/* Rank of the key of the current try, zero for none */
+	uint64_t key_rank;
+} response_ctx;
+
+struct trace_ring;
+struct trace_writer;
+struct selfmon;
+
 
 /*Client context for a specific run*/
 typedef struct client_context {
@@ -71,15 +168,87 @@ typedef struct client_context {
 	long num_tries;
 	/* identifies the current run, among previous ones */
 	long current_run;
-	/* Time to run in msec.  Zero means time to run is infinite.  */
+	/* Time to run in msec.  Zero means the run is limited by num_tries only.  */
 	unsigned long run_time;
+	/* Flag; when true, raw results of each try are kept and written to
+	   <run-name>.samples. Otherwise only the histograms are kept.  */
+	int keep_samples;
+	/* Number of transfers kept in flight by the multi loop. Zero means
+	   the tries are fetched one after another by curl_easy_perform ().  */
+	long concurrency;
+	/* Number of worker threads, each runs its own loop with its own handles.
+	   Zero is the same as one.  */
+	long threads;
+	/* Requests per second, sent on schedule whatever the responses are
+	   (open loop). Zero means the next request is sent, when a previous one
+	   completes (closed loop).  */
+	double rate;
+	/* Distribution of the inter-arrival times of the scheduled requests */
+	arrival_type arrival;
+	/* Flag; when true, worker threads are pinned to CPUs round-robin */
+	int cpu_affinity;
+	/* Flag; when true, all the handles of the run share DNS cache, TLS
+	   sessions and, with a single worker, the connection pool.  */
+	int share_caches;
+	/* Flag; when true, the results of each try are written to <run-name>.trace */
+	int trace;
+	/* Flag; when true, the interval reports count cycles and instructions
+	   per try of the workers by perf counters  */
+	int perf_counters;
+	/* Directory of the response capture ring files */
+	char* dir_log;
+	/* One response out of <log_sample> is captured, zero is the same as one */
+	long log_sample;
+	/* Size of the response capture ring of a worker in MB, zero for the default */
+	long log_ring_size;
+	/* Interval of the reports to the statistics file in msec, zero for none */
+	unsigned long report_interval;
+	/* Significant decimal digits kept by the latency histograms */
+	int hist_precision;
+	/* Percent of failed tries in a window of a worker, that aborts the run,
+	   zero to never abort  */
+	double max_error_rate;
+	/* HTTP versions, CURL_HTTP_VERSION_*, the workload is run with one after
+	   another for their comparison; none for a single run  */
+	long compare_versions[HTTP_VERSIONS_MAX];
+	int compare_versions_num;
+	/* HTTP version of the current comparison pass, it overrides the ones
+	   of the urls; CURL_HTTP_VERSION_NONE outside the comparison  */
+	long http_version;
+	/* Streams multiplexed on an HTTP/2 connection by the multi loop, zero
+	   for the libcurl default  */
+	long max_streams;
+	/* Seconds a resolved name is cached by the urls of DNS_MODE cached,
+	   -1 for the whole run  */
+	long dns_cache_ttl;
 	/* User-agent string to appear in the HTTP 1/1 requests.  */
 	char user_agent[256];
+	/* Name of the header carrying <worker>-<try> of each request, NULL for none */
+	char* try_id_header;
+	/* Seed of the random generators of the workers, the same seed gives
+	   the same random values of the run  */
+	uint64_t seed;
+	/* Size of the arena of a handle, long enough for the renderings of
+	   the placeholders of any url  */
+	size_t arena_size;
+	/* Keys of {{key}}, drawn per try by their distribution over the ranks */
+	keyspace keyspace;
 
 	/* URL SECTION - fetching urls */
 
-	/* contains all specifics related to url */
-	url_context url;
+	/* The urls of the workload, each with its own method, headers and
+	   timeouts. A URL tag starts a new one, the url tags after it apply
+	   to it.  */
+	url_context* urls;
+	int urls_num;
+	int urls_size;
+
+	/* Picks the url of a try by the weights, when there are several */
+	alias_table url_picker;
+
+	/* The url being configured by the parser, the one of the current
+	   try afterwards */
+	url_context* url;
 
 	/* statistics related */
 	client_stats st;
@@ -89,6 +258,25 @@ typedef struct client_context {
 	/* Library handle, for using libcurl API.  */
 	CURL* handle;
 
+	/* Handle with the options common to all the tries of the worker, the
+	   handles of the tries are cloned from it  */
+	CURL* handle_tmpl;
+
+	/* Share handle of the run, NULL when the caches are private */
+	CURLSH* share;
+
+	/* Index of the worker running the context */
+	int worker_id;
+
+	/* Pseudo random generator of the worker */
+	rng_state rng;
+
+	/* State of the response callbacks of the context handle */
+	response_ctx response;
+
+	/* Response capture ring of the worker, NULL when nothing is logged */
+	capture_ring* capture;
+
 	/* Common error buffer for clients context */
 	char error_buffer[CURL_ERROR_SIZE];
 
@@ -97,10 +285,35 @@ typedef struct client_context {
 
 	/* STATISTICS  */
 
+	/* Statistics shard of the worker, the tries are recorded to */
+	stats_shard* shard;
+
+	/* Tries of the worker before its steady state, the allocations by
+	   libcurl when it was reached and the ones made since  */
+	long alloc_warmup;
+	unsigned long long allocs_warm;
+	unsigned long long allocs_steady;
+
+	/* Tries of the current error rate window of the worker and the failed
+	   ones among them  */
+	long window_tries;
+	long window_failed;
+
+	/* Cost of the worker sampled by the interval reports, NULL without them */
+	struct selfmon* mon;
+
+	/* Intervals reported and the ones, the workers were saturated in */
+	long intervals_num;
+	long intervals_saturated;
+
+	/* Trace writer of the run and the ring of the worker, NULL without a trace */
+	struct trace_writer* trace_writer;
+	struct trace_ring* trace_ring;
+
 	/* The file to be used for statistics output */
 	FILE* statistics_file;
 
-	/* Timestamp, when the loading started */
+	/* Timestamp, when the loading started, monotonic usec */
 	unsigned long start_time; 
 
 	/* The last timestamp */
@@ -115,6 +328,12 @@ int parse_command_line (int argc, char *argv []);
 /* Parses config file and fills the configuration params. */
 int parse_config_file(char* const filename, client_context *ctx); 
 
+/* Name of an HTTP version, CURL_HTTP_VERSION_*, as in the config */
+const char* http_version_name (long version);
+
+/* Name of a DNS mode, DNS_MODE_*, as in the config */
+const char* dns_mode_name (int mode);
+
 /* Prints out usage of the program.  */
 void print_help ();
 
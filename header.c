@@ -0,0 +1,132 @@
+/*
+ *     header.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "header.h"
+
+
+/*
+* Description - Builds the fixed headers of a url from the list as parsed.
+*               The nodes and the strings are copied into a single block, so
+*               that libcurl walks contiguous memory when sending a request.
+*
+* Input  -      *hs     - the header set to build
+*               *parsed - the headers as appended by the config parser
+* Return -      On Success - 0, on Error -1
+*/
+int header_set_build (header_set* hs, const struct curl_slist* parsed)
+{
+	const struct curl_slist* item;
+	struct curl_slist* nodes;
+	size_t strings = 0;
+	char* str;
+	int i = 0;
+
+	memset (hs, 0, sizeof (header_set));
+
+	for (item = parsed; item; item = item->next) {
+		strings += strlen (item->data) + 1;
+		hs->num++;
+	}
+
+	if (!hs->num) {
+		return 0;
+	}
+
+	hs->size = hs->num * sizeof (struct curl_slist) + strings;
+
+	if (!(nodes = (struct curl_slist *) malloc (hs->size))) {
+		fprintf (stderr, "%s - error: allocation of %zu bytes failed.\n",
+				__func__, hs->size);
+		return -1;
+	}
+
+	str = (char *) (nodes + hs->num);
+
+	for (item = parsed; item; item = item->next, i++) {
+		size_t len = strlen (item->data) + 1;
+
+		memcpy (str, item->data, len);
+		nodes[i].data = str;
+		nodes[i].next = (i + 1 < hs->num) ? &nodes[i + 1] : NULL;
+		str += len;
+	}
+
+	hs->list = nodes;
+
+	return 0;
+}
+
+
+/*
+* Description - Releases the block of the fixed headers
+*
+* Input  -      *hs - the header set
+*/
+void header_set_free (header_set* hs)
+{
+	free (hs->list);
+	memset (hs, 0, sizeof (header_set));
+}
+
+
+/*
+* Description - Forgets the variable headers of the previous try
+*
+* Input  -      *sc - variable headers of a handle
+*/
+void header_scratch_reset (header_scratch* sc)
+{
+	sc->num = 0;
+}
+
+
+/*
+* Description - Adds a variable header of the try
+*
+* Input  -      *sc   - variable headers of a handle
+*               *line - the header line, kept until the try is over
+* Return -      On Success - 0, on Error -1
+*/
+int header_scratch_add (header_scratch* sc, char* line)
+{
+	if (sc->num == HEADER_VARS_MAX) {
+		fprintf (stderr, "%s - error: more than %d variable headers.\n",
+				__func__, HEADER_VARS_MAX);
+		return -1;
+	}
+
+	sc->nodes[sc->num++].data = line;
+
+	return 0;
+}
+
+
+/*
+* Description - Chains the variable headers of the try in front of the fixed
+*               headers of its url
+*
+* Input  -      *sc    - variable headers of a handle
+*               *fixed - fixed headers of the url
+* Return -      The list to hand over to libcurl, NULL for no headers
+*/
+struct curl_slist* header_scratch_chain (header_scratch* sc, const header_set* fixed)
+{
+	int i;
+
+	if (!sc->num) {
+		return fixed->list;
+	}
+
+	for (i = 0; i < sc->num; i++) {
+		sc->nodes[i].next = (i + 1 < sc->num) ? &sc->nodes[i + 1] : fixed->list;
+	}
+
+	return sc->nodes;
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,58 @@
+/*
+ *     header.h
+ *
+ */
+#ifndef HEADER_H
+#define HEADER_H
+
+#include <stddef.h>
+#include <curl/curl.h>
+
+/* Variable headers of a try, at most */
+#define HEADER_VARS_MAX 16
+
+/* Fixed headers of a url, built once when the config is read. The list
+   nodes and the header strings are kept in one block; the list is handed
+   to libcurl by reference and never changes during the run.  */
+typedef struct header_set {
+
+	/* The list, NULL for no headers. The nodes come first in the block,
+	   the strings follow them.  */
+	struct curl_slist* list;
+
+	/* Number of the headers */
+	int num;
+
+	/* Size of the block */
+	size_t size;
+
+} header_set;
+
+/* Variable headers of a handle, rendered for each try into the arena of
+   the handle and chained in front of the fixed headers of the url. Nothing
+   is allocated per try.  */
+typedef struct header_scratch {
+
+	/* Nodes of the variable headers */
+	struct curl_slist nodes[HEADER_VARS_MAX];
+	int num;
+
+} header_scratch;
+
+/* Builds the fixed headers from the list as parsed */
+int header_set_build (header_set* hs, const struct curl_slist* parsed);
+
+/* Releases the block of the fixed headers */
+void header_set_free (header_set* hs);
+
+/* Forgets the variable headers of the previous try */
+void header_scratch_reset (header_scratch* sc);
+
+/* Adds a variable header, rendered for the try */
+int header_scratch_add (header_scratch* sc, char* line);
+
+/* Chains the variable headers in front of the fixed ones, returns the list */
+struct curl_slist* header_scratch_chain (header_scratch* sc, const header_set* fixed);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,295 @@
+/*
+ *     hist.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "hist.h"
+
+/* forward declaration */
+static long counts_index_for (const hist* h, long long value);
+static long long lowest_equivalent_value (const hist* h, long index);
+static long long highest_equivalent_value (const hist* h, long index);
+
+
+/*
+* Description - Allocates the counters of a histogram, that keeps <precision>
+*               significant decimal digits for values from 0 up to
+*               HIST_HIGHEST_TRACKABLE.
+*
+* Input  -      *h        - the histogram to init
+*               precision - number of significant decimal digits, 1 to 5
+* Return -      On Success - 0, on Error -1
+*/
+int hist_init (hist* h, int precision)
+{
+	long long largest_single_unit;
+	long long smallest_untrackable;
+	int sub_bucket_count_magnitude;
+	long long sub_bucket_count;
+	int buckets_num;
+
+	if (!h || precision < 1 || precision > HIST_PRECISION_MAX) {
+		return -1;
+	}
+
+	memset (h, 0, sizeof (hist));
+	h->precision = precision;
+
+	/* A sub-bucket per unit is needed up to 2 * 10^precision to keep the
+	   relative error below 10^-precision */
+	largest_single_unit = 2;
+	while (precision--) {
+		largest_single_unit *= 10;
+	}
+
+	sub_bucket_count_magnitude = 0;
+	while ((1LL << sub_bucket_count_magnitude) < largest_single_unit) {
+		sub_bucket_count_magnitude++;
+	}
+
+	sub_bucket_count = 1LL << sub_bucket_count_magnitude;
+
+	h->sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+	h->sub_bucket_half_count = sub_bucket_count / 2;
+	h->sub_bucket_mask = sub_bucket_count - 1;
+
+	/* Buckets, needed to cover the highest trackable value */
+	smallest_untrackable = sub_bucket_count;
+	buckets_num = 1;
+
+	while (smallest_untrackable <= HIST_HIGHEST_TRACKABLE) {
+		smallest_untrackable <<= 1;
+		buckets_num++;
+	}
+
+	h->counts_len = (buckets_num + 1) * h->sub_bucket_half_count;
+
+	if (!(h->counts = (long long *) calloc (h->counts_len, sizeof (long long)))) {
+		fprintf (stderr, "%s - error: allocation of %ld counters failed.\n",
+				__func__, h->counts_len);
+		return -1;
+	}
+
+	hist_reset (h);
+
+	return 0;
+}
+
+
+/*
+* Description - Releases the counters of a histogram
+*
+* Input  -      *h - the histogram
+*/
+void hist_free (hist* h)
+{
+	if (h) {
+		free (h->counts);
+		h->counts = NULL;
+	}
+}
+
+
+/*
+* Description - Forgets all the recorded values, keeping the counters memory
+*
+* Input  -      *h - the histogram
+*/
+void hist_reset (hist* h)
+{
+	if (h->counts) {
+		memset (h->counts, 0, h->counts_len * sizeof (long long));
+	}
+
+	h->total_count = 0;
+	h->min = HIST_HIGHEST_TRACKABLE;
+	h->max = 0;
+	h->sum = 0;
+}
+
+
+/*
+* Description - Records a value. Negative values are recorded as zero and the
+*               values above HIST_HIGHEST_TRACKABLE as the highest trackable.
+*
+* Input  -      *h    - the histogram
+*               value - the value to record
+*/
+void hist_record (hist* h, long long value)
+{
+	if (value < 0) {
+		value = 0;
+	} else if (value > HIST_HIGHEST_TRACKABLE) {
+		value = HIST_HIGHEST_TRACKABLE;
+	}
+
+	h->counts[counts_index_for (h, value)]++;
+	h->total_count++;
+	h->sum += value;
+
+	if (value < h->min) {
+		h->min = value;
+	}
+	if (value > h->max) {
+		h->max = value;
+	}
+}
+
+
+/*
+* Description - Adds the recorded values of one histogram to another one
+*
+* Input  -      *dst - the histogram to add to
+*               *src - the histogram to add, of the same precision
+* Return -      On Success - 0, on Error -1
+*/
+int hist_merge (hist* dst, const hist* src)
+{
+	long i;
+
+	if (!dst || !src || dst->counts_len != src->counts_len) {
+		fprintf (stderr, "%s - error: histograms of different precision.\n",
+				__func__);
+		return -1;
+	}
+
+	if (!src->total_count) {
+		return 0;
+	}
+
+	for (i = 0; i < dst->counts_len; i++) {
+		dst->counts[i] += src->counts[i];
+	}
+
+	dst->total_count += src->total_count;
+	dst->sum += src->sum;
+
+	if (src->min < dst->min) {
+		dst->min = src->min;
+	}
+	if (src->max > dst->max) {
+		dst->max = src->max;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Finds the value, at or below which the given percentage of the
+*               recorded values fall. The value is reported as the highest
+*               one equivalent to the sub-bucket, clamped to the recorded range.
+*
+* Input  -      *h         - the histogram
+*               percentile - percentage, 0 to 100
+* Return -      The value, 0 for an empty histogram
+*/
+long long hist_value_at_percentile (const hist* h, double percentile)
+{
+	long long count_at_percentile;
+	long long total = 0;
+	long long value;
+	long i;
+
+	if (!h->total_count) {
+		return 0;
+	}
+
+	if (percentile > 100.0) {
+		percentile = 100.0;
+	}
+
+	count_at_percentile = (long long) ((percentile / 100.0) * h->total_count + 0.5);
+
+	if (count_at_percentile < 1) {
+		count_at_percentile = 1;
+	}
+
+	for (i = 0; i < h->counts_len; i++) {
+		total += h->counts[i];
+
+		if (total >= count_at_percentile) {
+			value = highest_equivalent_value (h, i);
+			return value > h->max ? h->max : (value < h->min ? h->min : value);
+		}
+	}
+
+	return h->max;
+}
+
+
+/*
+* Description - Mean of the recorded values
+*
+* Input  -      *h - the histogram
+* Return -      The mean, 0 for an empty histogram
+*/
+double hist_mean (const hist* h)
+{
+	return h->total_count ? (double) (h->sum / h->total_count) : 0;
+}
+
+
+/*
+* Description - Index of the counter of a value. The bucket is given by the
+*               highest set bit of the value, the sub-bucket by the bits below.
+*
+* Input  -      *h    - the histogram
+*               value - the value, from 0 up to HIST_HIGHEST_TRACKABLE
+* Return -      Index into h->counts
+*/
+static long counts_index_for (const hist* h, long long value)
+{
+	int pow2ceiling = 64 - __builtin_clzll ((unsigned long long) (value | h->sub_bucket_mask));
+	int bucket_index = pow2ceiling - (h->sub_bucket_half_count_magnitude + 1);
+	long long sub_bucket_index = value >> bucket_index;
+
+	return (long) (((long long) (bucket_index + 1) << h->sub_bucket_half_count_magnitude) +
+		(sub_bucket_index - h->sub_bucket_half_count));
+}
+
+
+/*
+* Description - The lowest value, that falls into the counter of an index
+*
+* Input  -      *h    - the histogram
+*               index - index into h->counts
+* Return -      The value
+*/
+static long long lowest_equivalent_value (const hist* h, long index)
+{
+	int bucket_index = (int) (index >> h->sub_bucket_half_count_magnitude) - 1;
+	long long sub_bucket_index = (index & (h->sub_bucket_half_count - 1)) +
+		h->sub_bucket_half_count;
+
+	if (bucket_index < 0) {
+		sub_bucket_index -= h->sub_bucket_half_count;
+		bucket_index = 0;
+	}
+
+	return sub_bucket_index << bucket_index;
+}
+
+
+/*
+* Description - The highest value, that falls into the counter of an index
+*
+* Input  -      *h    - the histogram
+*               index - index into h->counts
+* Return -      The value
+*/
+static long long highest_equivalent_value (const hist* h, long index)
+{
+	int bucket_index = (int) (index >> h->sub_bucket_half_count_magnitude) - 1;
+
+	if (bucket_index < 0) {
+		bucket_index = 0;
+	}
+
+	return lowest_equivalent_value (h, index) + (1LL << bucket_index) - 1;
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
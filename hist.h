@@ -0,0 +1,76 @@
+/*
+ *     hist.h
+ *
+ */
+#ifndef HIST_H
+#define HIST_H
+
+/* Default number of significant decimal digits kept by a histogram */
+#define HIST_PRECISION_DEFAULT 2
+
+/* Maximum number of significant decimal digits */
+#define HIST_PRECISION_MAX 5
+
+/* Highest value tracked by the histograms, one hour in usec. Larger
+   values are recorded as this one.  */
+#define HIST_HIGHEST_TRACKABLE 3600000000LL
+
+/* Log-linear (HDR-style) histogram of non-negative integer values.
+   Values are split into buckets by powers of two, each bucket is split
+   linearly into sub-buckets, so that the relative error of any value is
+   below 10^-precision. The memory is fixed at init, recording is O(1).  */
+typedef struct hist {
+
+	/* Number of significant decimal digits kept */
+	int precision;
+
+	/* log2 of the half of the sub-buckets per bucket */
+	int sub_bucket_half_count_magnitude;
+
+	/* Half of the sub-buckets per bucket */
+	long long sub_bucket_half_count;
+
+	/* Mask of the values falling into the first bucket */
+	long long sub_bucket_mask;
+
+	/* Number of the counters */
+	long counts_len;
+
+	/* Counters of the sub-buckets */
+	long long* counts;
+
+	/* Number of the recorded values */
+	long long total_count;
+
+	/* Lowest and highest recorded values */
+	long long min;
+	long long max;
+
+	/* Sum of the recorded values, for the mean */
+	long double sum;
+
+} hist;
+
+/* Allocates the counters for values up to HIST_HIGHEST_TRACKABLE */
+int hist_init (hist* h, int precision);
+
+/* Releases the counters */
+void hist_free (hist* h);
+
+/* Forgets all the recorded values, the memory is kept */
+void hist_reset (hist* h);
+
+/* Records a value in O(1) */
+void hist_record (hist* h, long long value);
+
+/* Adds the values of <src> to <dst>, both with the same precision */
+int hist_merge (hist* dst, const hist* src);
+
+/* Value, below which <percentile> percent of the recorded values fall */
+long long hist_value_at_percentile (const hist* h, double percentile);
+
+/* Mean of the recorded values */
+double hist_mean (const hist* h);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,201 @@
+/*
+ *     keyspace.c
+ *
+ */
+#include <stdio.h>
+#include <math.h>
+
+#include "keyspace.h"
+
+/* forward declaration */
+static double h (const keyspace* ks, double x);
+static double h_integral (const keyspace* ks, double x);
+static double h_integral_inverse (const keyspace* ks, double x);
+static double helper1 (double x);
+static double helper2 (double x);
+
+
+/*
+* Description - Checks the params of a keyspace and computes the constants
+*               of its distribution. Zipf is sampled by rejection-inversion
+*               (Hormann and Derflinger), that needs neither a table nor a
+*               pass over the keys, whatever their number.
+*
+* Input  -      *ks - the keyspace, with keys, dist and its params set
+* Return -      On Success - 0, on Error -1
+*/
+int keyspace_init (keyspace* ks)
+{
+	if (!ks->keys) {
+		fprintf (stderr, "%s - error: the keyspace has no keys.\n", __func__);
+		return -1;
+	}
+
+	switch (ks->dist) {
+	case KEY_DIST_UNIFORM:
+		break;
+
+	case KEY_DIST_ZIPF:
+		if (!(ks->s > 0)) {
+			fprintf (stderr, "%s - error: exponent of zipf (%g) should be positive.\n",
+					__func__, ks->s);
+			return -1;
+		}
+		ks->h_integral_x1 = h_integral (ks, 1.5) - 1.0;
+		ks->h_integral_n = h_integral (ks, (double) ks->keys + 0.5);
+		ks->accept = 2.0 - h_integral_inverse (ks, h_integral (ks, 2.5) - h (ks, 2.0));
+		break;
+
+	case KEY_DIST_HOTSPOT:
+		if (!(ks->hot_fraction > 0 && ks->hot_fraction < 1) ||
+				!(ks->hot_share >= 0 && ks->hot_share <= 1)) {
+			fprintf (stderr, "%s - error: hotspot of %g keys and %g tries is out of "
+					"range.\n", __func__, ks->hot_fraction, ks->hot_share);
+			return -1;
+		}
+		ks->hot_keys = (uint64_t) ((double) ks->keys * ks->hot_fraction);
+		if (ks->hot_keys < 1) {
+			ks->hot_keys = 1;
+		}
+		break;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Draws the rank of the key of a try
+*
+* Input  -      *ks  - the keyspace
+*               *rng - the generator of the worker
+* Return -      The rank, 1 to ks->keys
+*/
+uint64_t keyspace_pick (const keyspace* ks, rng_state* rng)
+{
+	double u, x;
+	uint64_t k;
+
+	switch (ks->dist) {
+	case KEY_DIST_ZIPF:
+		/* a few rounds at most, the acceptance rate is high for any s */
+		while (1) {
+			u = ks->h_integral_n + rng_double (rng) * (ks->h_integral_x1 - ks->h_integral_n);
+			x = h_integral_inverse (ks, u);
+			k = (uint64_t) (x + 0.5);
+
+			if (k < 1) {
+				k = 1;
+			} else if (k > ks->keys) {
+				k = ks->keys;
+			}
+
+			if ((double) k - x <= ks->accept ||
+					u >= h_integral (ks, (double) k + 0.5) - h (ks, (double) k)) {
+				return k;
+			}
+		}
+
+	case KEY_DIST_HOTSPOT:
+		if (ks->hot_keys == ks->keys || rng_double (rng) < ks->hot_share) {
+			return rng_range (rng, 1, ks->hot_keys);
+		}
+		return rng_range (rng, ks->hot_keys + 1, ks->keys);
+
+	default:
+		return rng_range (rng, 1, ks->keys);
+	}
+}
+
+
+/*
+* Description - Rank bucket of a key, a decade of ranks each
+*
+* Input  -      rank - rank of the key, from 1
+* Return -      The bucket, 0 for the ranks 1-9, 1 for 10-99 and so on
+*/
+int keyspace_bucket (uint64_t rank)
+{
+	int bucket = 0;
+
+	while (rank >= 10) {
+		rank /= 10;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+
+/*
+* Description - Number of the rank buckets of a keyspace
+*
+* Input  -      *ks - the keyspace
+* Return -      The number
+*/
+int keyspace_buckets (const keyspace* ks)
+{
+	return keyspace_bucket (ks->keys) + 1;
+}
+
+
+/*
+* Description - Density of Zipf up to the norm, x^-s
+*/
+static double h (const keyspace* ks, double x)
+{
+	return exp (-ks->s * log (x));
+}
+
+
+/*
+* Description - Integral of h (), (x^(1-s) - 1) / (1-s), and log(x) for s of 1
+*/
+static double h_integral (const keyspace* ks, double x)
+{
+	double log_x = log (x);
+
+	return helper2 ((1.0 - ks->s) * log_x) * log_x;
+}
+
+
+/*
+* Description - Inverse of h_integral ()
+*/
+static double h_integral_inverse (const keyspace* ks, double x)
+{
+	double t = x * (1.0 - ks->s);
+
+	if (t < -1.0) {
+		/* limited by the rounding errors */
+		t = -1.0;
+	}
+
+	return exp (helper1 (t) * x);
+}
+
+
+/*
+* Description - log(1+x)/x, precise near 0
+*/
+static double helper1 (double x)
+{
+	if (fabs (x) > 1e-8) {
+		return log1p (x) / x;
+	}
+	return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+
+/*
+* Description - (exp(x)-1)/x, precise near 0
+*/
+static double helper2 (double x)
+{
+	if (fabs (x) > 1e-8) {
+		return expm1 (x) / x;
+	}
+	return 1.0 + x * 0.5 * (1.0 + x * 1.0 / 3.0 * (1.0 + 0.25 * x));
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,62 @@
+/*
+ *     keyspace.h
+ *
+ */
+#ifndef KEYSPACE_H
+#define KEYSPACE_H
+
+#include <stdint.h>
+
+#include "rng.h"
+
+/* Rank buckets of the key statistics, a decade of ranks each: 1-9, 10-99,
+   100-999 and so on, up to 10^19 keys  */
+#define KEYSPACE_BUCKETS_MAX 20
+
+/* Distributions of the keys over the tries */
+typedef enum key_dist {
+	KEY_DIST_UNIFORM = 0,   /* every key equally likely */
+	KEY_DIST_ZIPF,          /* key of rank k with probability ~ 1 / k^s */
+	KEY_DIST_HOTSPOT,       /* a share of the tries to a fraction of the keys */
+} key_dist;
+
+/* Keys 1 to <keys>, ranked by popularity, 1 being the most popular one. No
+   list of the keys is kept, a key is drawn from the constants below.  */
+typedef struct keyspace {
+
+	/* Number of the keys, zero when there is no keyspace */
+	uint64_t keys;
+
+	/* Distribution of the keys */
+	key_dist dist;
+
+	/* Exponent of Zipf */
+	double s;
+
+	/* Hotspot: the fraction of the keys, that are hot, and the share
+	   of the tries, that go to them */
+	double hot_fraction;
+	double hot_share;
+	uint64_t hot_keys;
+
+	/* Constants of the rejection-inversion sampling of Zipf */
+	double h_integral_x1;
+	double h_integral_n;
+	double accept;
+
+} keyspace;
+
+/* Computes the constants of the distribution, once the params are set */
+int keyspace_init (keyspace* ks);
+
+/* Draws the rank of the key of a try, in O(1) */
+uint64_t keyspace_pick (const keyspace* ks, rng_state* rng);
+
+/* Rank bucket of a key */
+int keyspace_bucket (uint64_t rank);
+
+/* Number of the rank buckets of the keyspace */
+int keyspace_buckets (const keyspace* ks);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
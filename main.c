@@ -7,8 +7,10 @@
 #include <string.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -20,118 +22,365 @@
 #include "conf.h"
 #include "url.h"
 #include "run_context.h"
+#include "worker.h"
+#include "share.h"
+#include "multi_loop.h"
+#include "report.h"
+#include "trace.h"
+#include "alloc.h"
 
 #define MAX_HEADER_LEN 50
 
-
-int cmpfunc (const void * a, const void * b) {
-    return ( *(long int*)a - *(long int*)b );
+/* Results of a run of the workload, compared among the HTTP versions */
+typedef struct pass_result {
+    long version;
+    long negotiated;
+    long long tries;
+    long long failed;
+    long long connects;
+    double throughput;
+    long long p50;
+    long long p99;
+    long long p999;
+    double cpu_per_try;
+    int aborted;
+} pass_result;
+
+
+/* secs of a time of the resource usage */
+static double
+usage_secs(const struct timeval *tv) {
+
+    return (double) tv->tv_sec + (double) tv->tv_usec / 1000000;
 }
 
-/* function to calculate the median of the array data */
-float find_median(long int array[] , int n) {
 
-    float median=0;
+static void 
+display_stats(client_context *ctx, worker *workers, int workers_num, long long elapsed,
+        const struct rusage *start_usage, pass_result *result) {
+
+    stats_shard total;
+    char title[256];
+    unsigned long long low;
+    unsigned long long allocs = 0;
+    long long allocs_tries = 0;
+    struct rusage usage;
+    double cpu, user, sys, setup;
+    int i;
+
+    /* merge the stats shards of the workers */
+    if (stats_shard_init (&total, ctx->hist_precision, 0) == -1 ||
+            (ctx->urls_num > 1 &&
+             stats_shard_init_urls (&total, ctx->hist_precision, ctx->urls_num) == -1) ||
+            (ctx->keyspace.keys &&
+             stats_shard_init_keys (&total, ctx->hist_precision,
+                 keyspace_buckets (&ctx->keyspace)) == -1)) {
+        fprintf (stderr,"%s - error: stats_shard_init () failed.\n",__func__);
+        stats_shard_free (&total);
+        return;
+    }
 
-    /* if number of elements are even */
-    if (n%2 == 0) {
-        median = (array[(n-1)/2] + array[n/2])/2.0;
-    } else {
-        /* if number of elements are odd */
-        median = array[n/2];
+    for (i = 0; i < workers_num; i++) {
+        stats_shard_merge (&total, &workers[i].shard);
+
+        /* ip and response code of the run are the last ones seen */
+        if (workers[i].shard.all.tries) {
+            ctx->st = workers[i].ctx.st;
+        }
+
+        if (workers[i].ctx.current_run > workers[i].ctx.alloc_warmup) {
+            allocs += workers[i].ctx.allocs_steady;
+            allocs_tries += workers[i].ctx.current_run - workers[i].ctx.alloc_warmup;
+        }
     }
 
-    return median;
-}
+    printf("Ip= %s; Response code = %ld; HTTP version = %s;\n",ctx->st.server_ip,
+            ctx->st.resp_code, http_version_name (ctx->st.http_version));
+    printf("Run time = %06f secs; Throughput = %.1f tries/sec;\n", (double) elapsed / 1000000,
+            elapsed > 0 ? (double) total.all.tries * 1000000 / elapsed : 0.0);
 
-static void 
-get_start_time_sorted(client_context *ctx, long int **st, client_stats *cs) 
-{
+    if (ctx->rate > 0) {
+        printf("Scheduled rate = %.1f tries/sec, %s arrivals; response time counts from the scheduled send;\n",
+                ctx->rate, ctx->arrival == ARRIVAL_POISSON ? "poisson" : "constant");
+    }
 
-    int count =0;
+    /* cost of the client itself, all the threads, since the run started */
+    getrusage (RUSAGE_SELF, &usage);
+    user = usage_secs (&usage.ru_utime) - usage_secs (&start_usage->ru_utime);
+    sys = usage_secs (&usage.ru_stime) - usage_secs (&start_usage->ru_stime);
+    cpu = user + sys;
+    printf("Client cpu = user %.2f secs, sys %.2f secs, %.1f usec per try; "
+            "context switches = %ld voluntary, %ld involuntary;\n", user, sys,
+            total.all.tries ? cpu * 1000000 / total.all.tries : 0.0,
+            usage.ru_nvcsw - start_usage->ru_nvcsw, usage.ru_nivcsw - start_usage->ru_nivcsw);
+
+    /* the part of it spent setting the handles up for the tries */
+    if (total.all.tries) {
+        setup = hist_mean (&total.all.phase[PHASE_SETUP]) / 1000;
+        printf("Handle setup = %.2f usec per try, %.1f%% of the client cpu;\n", setup,
+                cpu > 0 ? setup * total.all.tries / (cpu * 10000) : 0.0);
+    }
 
-    for (count = 0 ; count < ctx->num_tries; count++) {
-        *(*st + count) = cs[count].start_transfer_time;  
+    if (ctx->intervals_saturated) {
+        printf("WARNING: samk was saturated in %ld of %ld intervals, their latency "
+                "is not valid, see %s;\n", ctx->intervals_saturated, ctx->intervals_num,
+                ctx->runtime_statistics);
     }
 
-    qsort(*st, ctx->num_tries, sizeof(long int), cmpfunc);
-}
+    /* the request state of samk is preallocated, the rest is by libcurl */
+    if (allocs_tries > 0) {
+        printf("Steady state allocations = %.2f per try (%llu by libcurl in %lld tries);\n",
+                (double) allocs / allocs_tries, allocs, allocs_tries);
+    }
 
-static void 
-get_namelookup_time_sorted(client_context *ctx, long int **st, client_stats *cs) 
-{
+    stats_print (stdout, "All", &total.all);
+
+    /* split of cold (new) and warm (reused) connections latency */
+    stats_print (stdout, "Cold connections", &total.cold);
+    stats_print (stdout, "Warm connections", &total.warm);
+
+    /* latency of the successes apart from the failures, when there are any */
+    if (total.failed.tries) {
+        stats_print (stdout, "Successful tries", &total.ok);
+        stats_print (stdout, "Failed tries", &total.failed);
+    }
+
+    /* latency by the status and by the server, when there are several */
+    if (total.statuses.keys_num > 1) {
+        stats_map_print (stdout, "Status", &total.statuses);
+    }
+    if (total.servers.keys_num > 1) {
+        stats_map_print (stdout, "Server", &total.servers);
+    }
 
-    int count =0;
+    /* name lookup and connect latency by the DNS mode of the urls */
+    for (i = DNS_MODE_COLD; i < DNS_MODES_NUM; i++) {
+        if (total.dns[i].tries) {
+            snprintf (title, sizeof (title), "DNS mode %s", dns_mode_name (i));
+            stats_print (stdout, title, &total.dns[i]);
+        }
+    }
 
-    for (count = 0 ; count < ctx->num_tries; count++) {
-        *(*st + count) = cs[count].namelookup_time;  
+    /* latency of each url of a weighted workload */
+    for (i = 0; i < total.urls_num; i++) {
+        snprintf (title, sizeof (title), "URL %s (weight %g)",
+                ctx->urls[i].url_str, ctx->urls[i].weight);
+        stats_print (stdout, title, &total.urls[i]);
     }
 
-    qsort(*st, ctx->num_tries, sizeof(long int), cmpfunc);
+    /* latency by the popularity of the keys, a decade of ranks each */
+    for (i = 0, low = 1; i < total.keys_num; i++, low *= 10) {
+        unsigned long long high = low <= ULLONG_MAX / 10 ? low * 10 - 1 : ULLONG_MAX;
+
+        if (high > ctx->keyspace.keys) {
+            high = ctx->keyspace.keys;
+        }
+        snprintf (title, sizeof (title), "Keys ranked %llu-%llu", low, high);
+        stats_print (stdout, title, &total.keys[i]);
+    }
+
+    if (result) {
+        const hist *h = &total.all.phase[PHASE_RESPONSE];
+
+        result->version = ctx->http_version;
+        result->negotiated = ctx->st.http_version;
+        result->tries = total.all.tries;
+        result->failed = total.failed.tries;
+        result->connects = total.cold.tries;
+        result->throughput = elapsed > 0 ? (double) total.all.tries * 1000000 / elapsed : 0.0;
+        result->p50 = hist_value_at_percentile (h, 50.0);
+        result->p99 = hist_value_at_percentile (h, 99.0);
+        result->p999 = hist_value_at_percentile (h, 99.9);
+        result->cpu_per_try = total.all.tries ? cpu * 1000000 / total.all.tries : 0.0;
+    }
+
+    stats_shard_free (&total);
 }
 
-static void 
-get_total_time_sorted(client_context *ctx, long int **st, client_stats *cs) 
-{
 
-    int count =0;
+/* writes the raw results of the tries, kept by the workers, to <run-name>.samples */
+static int
+write_samples(client_context *ctx, worker *workers, int workers_num) {
+
+    char filename[RUN_NAME_SIZE + 16];
+    FILE *fp;
+    int i;
+
+    snprintf(filename, sizeof (filename), "%s.samples",
+            ctx->run_name[0] ? ctx->run_name : "samk");
+
+    if (!(fp = fopen (filename, "w"))) {
+        fprintf (stderr, "%s - error: fopen() failed to open for writing \"%s\", errno %d.\n",
+                __func__, filename, errno);
+        return -1;
+    }
+
+    stats_write_samples_header (fp);
 
-    for (count = 0 ; count < ctx->num_tries; count++) {
-        *(*st + count) = cs[count].total_time;  
+    for (i = 0; i < workers_num; i++) {
+        stats_shard_write_samples (fp, i, &workers[i].shard);
     }
 
-    qsort(*st, ctx->num_tries, sizeof(long int), cmpfunc);
+    fclose (fp);
+
+    return 0;
 }
 
-static void 
-get_connect_time_sorted(client_context *ctx, long int **st, client_stats *cs) 
-{
 
-    int count =0;
+/*
+ * Runs the workload once: starts the workers, reports while they are loading
+ * and displays the results. Fills <result> for the comparison of the HTTP
+ * versions, when not NULL.
+ */
+static int
+run_pass(client_context *ctx, int workers_num, pass_result *result) {
+
+    worker *workers = NULL;
+    share_context share;
+    trace_writer trace;
+    struct rusage start_usage;
+    long long elapsed;
+    int ret = -1;
+
+    workers = (worker *) calloc(workers_num, sizeof (worker));
+
+    if (!workers) {
+        fprintf (stderr,"%s - error: malloc failed.\n",__func__);
+        return -1;
+    }
+
+    if (ctx->share_caches) {
+        /* libcurl does not support sharing connections among concurrent threads */
+        if (share_init (&share, workers_num == 1) == -1) {
+            fprintf (stderr,"%s - error: share_init () failed.\n",__func__);
+            free(workers);
+            return -1;
+        }
+        ctx->share = share.share;
+    }
+
+    if (ctx->trace) {
+        if (trace_writer_start (&trace, ctx->run_name, workers_num) == -1) {
+            fprintf (stderr,"%s - error: trace_writer_start () failed.\n",__func__);
+            if (ctx->share) {
+                share_cleanup (&share);
+            }
+            free(workers);
+            return -1;
+        }
+        ctx->trace_writer = &trace;
+    }
+
+    getrusage (RUSAGE_SELF, &start_usage);
+    ctx->start_time = monotonic_usec ();
 
-    for (count = 0 ; count < ctx->num_tries; count++) {
-        *(*st + count) = cs[count].connect_time;  
+    if ((ret = workers_start (ctx, workers, workers_num)) == 0) {
+
+        /* interval reports are written, while the workers are loading */
+        if (ctx->report_interval) {
+            report_run (ctx, workers, workers_num);
+        }
+
+        ret = workers_join (workers, workers_num);
+    }
+
+    elapsed = monotonic_usec () - ctx->start_time;
+
+    /* the tries left in the rings are written, once the workers are done */
+    if (ctx->trace_writer) {
+        trace_writer_stop (ctx->trace_writer);
+    }
+
+    if (ctx->share) {
+        share_cleanup (&share);
+    }
+
+    if (ret != 0) {
+        fprintf (stderr,"%s - error: get stats info failed.\n",__func__);
+        workers_cleanup (workers, workers_num);
+        free(workers);
+        return -1;
+    }
+
+    /* displays the results on screen */
+    display_stats(ctx, workers, workers_num, elapsed, &start_usage, result);
+
+    if (ctx->keep_samples) {
+        write_samples(ctx, workers, workers_num);
     }
 
-    qsort(*st, ctx->num_tries, sizeof(long int), cmpfunc);
+    workers_cleanup (workers, workers_num);
+    free(workers);
+
+    return 0;
 }
 
-static void 
-display_stats(client_context *ctx, client_stats *rt) {
 
-    long int *temp;
-    float m_c_time,m_t_time, m_nl_time,m_st_time;
+/*
+ * Runs the workload with each HTTP version of COMPARE_HTTP_VERSIONS in turn,
+ * the files of each run are named <run-name>-<version>, and prints the
+ * results side by side.
+ */
+static int
+compare_versions(client_context *ctx, int workers_num) {
+
+    pass_result results[HTTP_VERSIONS_MAX];
+    const char *name = ctx->run_name[0] ? ctx->run_name : "samk";
+    int passes = 0;
+    int ret = 0;
+    int i;
+
+    for (i = 0; i < ctx->compare_versions_num && !run_was_aborted (); i++) {
+        client_context pass = *ctx;
 
-    temp = (long int*) malloc( ctx->num_tries * sizeof (long int));
+        pass.http_version = ctx->compare_versions[i];
+        snprintf (pass.run_name, sizeof (pass.run_name), "%.40s-%s", name,
+                http_version_name (pass.http_version));
 
-    get_connect_time_sorted(ctx, &temp, rt);
-    m_c_time = find_median(temp, ctx->num_tries);
-    memset(temp, 0, ctx->num_tries * sizeof(long int));
+        printf("HTTP version %s (%s):\n", http_version_name (pass.http_version),
+                pass.run_name);
 
-    get_total_time_sorted(ctx, &temp, rt);
-    m_t_time = find_median(temp, ctx->num_tries);
-    memset(temp, 0, ctx->num_tries * sizeof(long int));
+        if ((ret = run_pass (&pass, workers_num, &results[passes])) != 0) {
+            break;
+        }
+
+        /* MAX_ERROR_RATE aborts the whole run, the other versions are not run */
+        results[passes++].aborted = run_was_aborted ();
+    }
 
-    get_start_time_sorted(ctx, &temp, rt);
-    m_st_time = find_median(temp, ctx->num_tries);
-    memset(temp, 0, ctx->num_tries * sizeof(long int));
+    printf("HTTP version comparison:\n");
 
-    get_namelookup_time_sorted(ctx, &temp, rt);
-    m_nl_time = find_median(temp, ctx->num_tries);
+    for (i = 0; i < passes; i++) {
+        const pass_result *r = &results[i];
 
-    printf("Ip= %s; Response code = %ld;\n",ctx->st.server_ip, ctx->st.resp_code);
-    printf("Median of: \n");
-    printf("Total time = %06f secs; Connect time = %06f secs ; Start time = %06f secs; Name lookup time = %06f secs;\n",
-             m_t_time/1000000, m_c_time/1000000, m_st_time/1000000, m_nl_time/100000);
+        /* a partial pass is not comparable to the complete ones */
+        if (r->aborted) {
+            printf("  %-20s aborted by MAX_ERROR_RATE after %lld tries, %lld failed; "
+                    "not comparable;\n", http_version_name (r->version), r->tries,
+                    r->failed);
+            continue;
+        }
 
-    free(temp);
+        printf("  %-20s %.1f tries/sec; response p50 %06f, p99 %06f, p99.9 %06f secs; "
+                "%lld tries, %lld failed, %lld on new connections; negotiated %s; "
+                "client cpu %.1f usec per try;\n", http_version_name (r->version),
+                r->throughput, (double) r->p50 / 1000000, (double) r->p99 / 1000000,
+                (double) r->p999 / 1000000, r->tries, r->failed, r->connects,
+                http_version_name (r->negotiated), r->cpu_per_try);
+    }
+
+    for (i = passes; i < ctx->compare_versions_num; i++) {
+        printf("  %-20s not run;\n", http_version_name (ctx->compare_versions[i]));
+    }
+
+    return ret;
 }
 
 
 int main (int argc, char *argv []) {
 
     int config_param = -1;
-    client_stats *rtime = NULL;
+    int workers_num;
     client_context ctx;
     int ret = -1;
 
@@ -144,46 +393,85 @@ int main (int argc, char *argv []) {
         return -1;
     }
 
+    /* Serve the requests of another samk, no run this time */
+    if (serve_config.port) {
+        return serve_run (&serve_config);
+    }
+
+    /* Convert a trace file of a previous run, no run this time */
+    if (dump_file[0]) {
+        return trace_dump (dump_file, dump_json ? TRACE_FORMAT_JSON : TRACE_FORMAT_CSV,
+                stdout);
+    }
+
     /* Parse the configuration file. Read the config params */
     if ((config_param = parse_config_file (config_file, &ctx)) < 0) {
         fprintf (stderr, "%s - error: parse_config_file () failed.\n", __func__);
         return -1;
     }
 
-    if (setup_init (&ctx) == -1) {
-        fprintf (stderr,"%s - error: init failed.\n",__func__);
-        return -1;
+    if (!ctx.hist_precision) {
+        ctx.hist_precision = HIST_PRECISION_DEFAULT;
+    }
+
+    if (!ctx.dns_cache_ttl) {
+        ctx.dns_cache_ttl = SHARE_DNS_CACHE_TIMEOUT;
     }
 
-    int count = ctx.num_tries;
+    if (!ctx.num_tries && !ctx.run_time) {
+        fprintf (stderr, "%s - error: either NUM_TRIES or RUN_TIME is to be set.\n", __func__);
+        return -1;
+    }
 
-    rtime = (client_stats *) malloc( ctx.num_tries * sizeof (client_stats));
+    /* scheduled sending is done by the multi loop only */
+    if (ctx.rate > 0 && !ctx.concurrency) {
+        ctx.concurrency = MULTI_LOOP_OPEN_CONCURRENCY;
+    }
 
-    if (!rtime) {
-        fprintf (stderr,"%s - error: malloc failed.\n",__func__);
+    /* streams are multiplexed by the multi loop only */
+    if (ctx.max_streams && !ctx.concurrency) {
+        fprintf (stderr, "%s - error: MAX_STREAMS_PER_CONN needs CONCURRENCY.\n", __func__);
         return -1;
     }
 
-    /* get the stats, for x number of runs */
-    while (count) {
+    workers_num = ctx.threads > 0 ? ctx.threads : 1;
 
-        if ((ret = get_stats_info(&ctx) !=0)) {
-            fprintf (stderr,"%s - error: get stats info failed.\n",__func__);
-            free(rtime);
-            return -1;
-        }
+    /* No sense to start more workers than tries */
+    if (ctx.num_tries && workers_num > ctx.num_tries) {
+        workers_num = ctx.num_tries;
+    }
 
-        rtime[ctx.current_run].total_time = ctx.st.total_time;
-        rtime[ctx.current_run].namelookup_time = ctx.st.namelookup_time;
-        rtime[ctx.current_run].connect_time = ctx.st.connect_time;
-        rtime[ctx.current_run].start_transfer_time = ctx.st.start_transfer_time;
-        count--; ctx.current_run++ ;
+    /* init libcurl once, before any thread is started; its allocations
+       are counted per worker  */
+    if (alloc_count_init (CURL_GLOBAL_ALL) == -1) {
+        return -1;
     }
 
-    /* displays the results on screen */
-    display_stats(&ctx, rtime);
+    /* a synchronous resolver blocks the whole multi loop of a worker for
+       the lookups of the cold names */
+    if (ctx.concurrency &&
+            !(curl_version_info (CURLVERSION_NOW)->features & CURL_VERSION_ASYNCHDNS)) {
+        fprintf (stderr, "%s - warning: libcurl resolves names synchronously, "
+                "the lookups stall the transfers in flight.\n", __func__);
+    }
+
+    if (ctx.compare_versions_num) {
+        ret = compare_versions (&ctx, workers_num);
+    } else {
+        ret = run_pass (&ctx, workers_num, NULL);
+    }
 
-    free(rtime);
+    curl_global_cleanup();
+
+    if (ret != 0) {
+        return -1;
+    }
+
+    /* the results are all there, but the run has not gone the full length */
+    if (run_was_aborted ()) {
+        fprintf (stderr, "%s - error: the run was aborted by MAX_ERROR_RATE.\n", __func__);
+        return -1;
+    }
 
     return 0;
 }
@@ -0,0 +1,594 @@
+/*
+ *     multi_loop.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <math.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <curl/curl.h>
+
+#include "conf.h"
+#include "run_context.h"
+#include "multi_loop.h"
+#include "trace.h"
+#include "selfmon.h"
+
+/* forward declaration */
+static int
+socket_callback (CURL* handle, curl_socket_t s, int what, void* userp, void* socketp);
+static int
+timer_callback (CURLM* multi, long timeout_ms, void* userp);
+static int check_completed (multi_loop* loop, client_context* ctx);
+static int loop_init (multi_loop* loop, client_context* ctx);
+static void loop_cleanup (multi_loop* loop);
+static int start_transfer (multi_loop* loop, client_context* ctx, transfer* slot,
+		long long intended);
+static int start_scheduled (multi_loop* loop, client_context* ctx);
+static void arm_send_timer (multi_loop* loop, client_context* ctx);
+static double next_interval (multi_loop* loop, client_context* ctx);
+static void measure_lag (multi_loop* loop, client_context* ctx, long long before,
+		int wait_ms);
+
+
+/*
+* Description - Fetches the url until the run is over, keeping up to
+*               ctx->concurrency transfers in flight. All the transfers are
+*               driven by a single multi handle, socket readiness is waited
+*               for with epoll and fed back via curl_multi_socket_action ().
+*               The tries are recorded to the statistics shard of the context.
+*
+*               With ctx->rate set the loop is open: tries are sent on schedule
+*               by a timerfd, whatever the responses are. A try, that finds no
+*               free slot, is sent as soon as one frees up, its response time
+*               still counted from the scheduled time.
+*
+* Input  -      *ctx - the client specific context structure
+* Return -      On Success - 0, on Error -1
+*/
+int run_multi_loop (client_context* ctx)
+{
+	multi_loop loop;
+	struct epoll_event events[MULTI_LOOP_MAX_EVENTS];
+	int running = 0;
+	int ret = -1;
+	int n, i;
+	long long now;
+	int wait_ms;
+
+	if (!ctx) {
+		return -1;
+	}
+
+	if (loop_init (&loop, ctx) == -1) {
+		fprintf (stderr, "%s - error: loop_init () failed.\n", __func__);
+		loop_cleanup (&loop);
+		return -1;
+	}
+
+	if (loop.open_loop) {
+		if (start_scheduled (&loop, ctx) == -1) {
+			goto out;
+		}
+	} else {
+		/* Put all the slots in flight */
+		while (loop.free_num && !run_is_over (ctx, loop.issued)) {
+			if (start_transfer (&loop, ctx, loop.free_slots[--loop.free_num],
+						monotonic_usec ()) == -1) {
+				goto out;
+			}
+		}
+	}
+
+	while (loop.completed < loop.issued ||
+			(loop.open_loop && !run_is_over (ctx, loop.issued))) {
+
+		if (loop.open_loop) {
+			arm_send_timer (&loop, ctx);
+		}
+
+		wait_ms = -1;
+		now = monotonic_usec ();
+
+		if (loop.timer_deadline >= 0) {
+			wait_ms = now >= loop.timer_deadline ? 0 :
+				(int) ((loop.timer_deadline - now + 999) / 1000);
+		}
+
+		n = epoll_wait (loop.epfd, events, MULTI_LOOP_MAX_EVENTS, wait_ms);
+
+		if (ctx->mon) {
+			measure_lag (&loop, ctx, now, wait_ms);
+		}
+
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf (stderr, "%s - error: epoll_wait () failed, errno %d.\n",
+					__func__, errno);
+			goto out;
+		}
+
+		for (i = 0; i < n; i++) {
+			int flags = 0;
+
+			if (events[i].data.fd == loop.timerfd) {
+				uint64_t expirations;
+
+				/* the due tries are started below */
+				if (read (loop.timerfd, &expirations, sizeof (expirations)) < 0) {
+					/* nothing to consume, a spurious wake-up */
+				}
+				continue;
+			}
+
+			if (events[i].events & EPOLLIN) {
+				flags |= CURL_CSELECT_IN;
+			}
+			if (events[i].events & EPOLLOUT) {
+				flags |= CURL_CSELECT_OUT;
+			}
+			if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+				flags |= CURL_CSELECT_ERR;
+			}
+
+			curl_multi_socket_action (loop.multi, events[i].data.fd, flags, &running);
+		}
+
+		/* libcurl timeout expired */
+		if (loop.timer_deadline >= 0 && monotonic_usec () >= loop.timer_deadline) {
+			loop.timer_deadline = -1;
+			curl_multi_socket_action (loop.multi, CURL_SOCKET_TIMEOUT, 0, &running);
+		}
+
+		if (check_completed (&loop, ctx) == -1) {
+			goto out;
+		}
+
+		if (loop.open_loop && start_scheduled (&loop, ctx) == -1) {
+			goto out;
+		}
+	}
+
+	ret = 0;
+
+out:
+	loop_cleanup (&loop);
+
+	return ret;
+}
+
+
+/*
+* Description - Reads the messages of the multi handle, records statistics of
+*               the completed transfers and re-adds their handles while the
+*               run is not over.
+*
+* Input  -      *loop - the multi loop
+*               *ctx  - the client specific context structure
+* Return -      On Success - 0, on Error -1
+*/
+static int check_completed (multi_loop* loop, client_context* ctx)
+{
+	CURLMsg* msg;
+	int msgs_left;
+	transfer* slot;
+
+	while ((msg = curl_multi_info_read (loop->multi, &msgs_left))) {
+
+		if (msg->msg != CURLMSG_DONE) {
+			continue;
+		}
+
+		curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, (char **) &slot);
+
+		/* a failed transfer is a result of the try as well, it is counted
+		   and the run goes on  */
+		if (msg->data.result != CURLE_OK) {
+			report_failed_try (ctx, slot->error_buffer, msg->data.result);
+		}
+
+		ctx->st.url_id = slot->response.url->id;
+		ctx->st.key_rank = slot->response.key_rank;
+		ctx->st.setup_time = slot->setup_time;
+
+		/* the last completed try provides ip and response code of the run */
+		if (collect_stats (ctx, slot->handle, msg->data.result, &ctx->st) == -1) {
+			return -1;
+		}
+
+		/* time waited for a free slot counts, coordinated omission otherwise */
+		ctx->st.response_time = (slot->started - slot->intended) + ctx->st.total_time;
+		ctx->st.send_time = slot->intended - (long long) ctx->start_time;
+
+		capture_end (&slot->response.capture, ctx->st.resp_code);
+
+		/* HTTP errors are counted on their own, their bodies are not checked */
+		ctx->st.bad_body = msg->data.result == CURLE_OK && ctx->st.resp_code < 400 &&
+			!validate_end (&slot->response.validate);
+
+		stats_shard_record (ctx->shard, &ctx->st);
+
+		if (ctx->trace_ring) {
+			trace_ring_push (ctx->trace_ring, &ctx->st);
+		}
+
+		ctx->current_run = ++loop->completed;
+		count_allocs (ctx);
+		check_error_rate (ctx);
+
+		curl_multi_remove_handle (loop->multi, slot->handle);
+
+		if (loop->open_loop) {
+			/* the slot waits for the next scheduled try */
+			loop->free_slots[loop->free_num++] = slot;
+		} else if (!run_is_over (ctx, loop->issued) &&
+				start_transfer (loop, ctx, slot, monotonic_usec ()) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Allocates the slots, sets up their handles and the multi
+*               handle with the epoll descriptor.
+*
+* Input  -      *loop - the multi loop to init
+*               *ctx  - the client specific context structure
+* Return -      On Success - 0, on Error -1
+*/
+static int loop_init (multi_loop* loop, client_context* ctx)
+{
+	long i;
+
+	memset (loop, 0, sizeof (multi_loop));
+	loop->epfd = -1;
+	loop->timerfd = -1;
+	loop->timer_deadline = -1;
+
+	/* No sense to keep more slots than tries */
+	loop->slots_num = (ctx->num_tries && ctx->num_tries < ctx->concurrency) ?
+		ctx->num_tries : ctx->concurrency;
+
+	if (!(loop->slots = (transfer *) calloc (loop->slots_num, sizeof (transfer)))) {
+		fprintf (stderr, "%s - error: allocation of %ld slots failed.\n",
+				__func__, loop->slots_num);
+		return -1;
+	}
+
+	if (!(loop->free_slots = (transfer **) calloc (loop->slots_num, sizeof (transfer *)))) {
+		fprintf (stderr, "%s - error: allocation of %ld slots failed.\n",
+				__func__, loop->slots_num);
+		return -1;
+	}
+
+	if ((loop->epfd = epoll_create1 (EPOLL_CLOEXEC)) == -1) {
+		fprintf (stderr, "%s - error: epoll_create1 () failed, errno %d.\n",
+				__func__, errno);
+		return -1;
+	}
+
+	if (ctx->rate > 0) {
+		struct epoll_event ev;
+
+		loop->open_loop = 1;
+		loop->interval = 1000000.0 / ctx->rate;
+		loop->next_send = (double) monotonic_usec ();
+
+		if ((loop->timerfd = timerfd_create (CLOCK_MONOTONIC,
+						TFD_NONBLOCK | TFD_CLOEXEC)) == -1) {
+			fprintf (stderr, "%s - error: timerfd_create () failed, errno %d.\n",
+					__func__, errno);
+			return -1;
+		}
+
+		memset (&ev, 0, sizeof (ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = loop->timerfd;
+
+		if (epoll_ctl (loop->epfd, EPOLL_CTL_ADD, loop->timerfd, &ev) == -1) {
+			fprintf (stderr, "%s - error: epoll_ctl () failed, errno %d.\n",
+					__func__, errno);
+			return -1;
+		}
+	}
+
+	if (!(loop->multi = curl_multi_init ())) {
+		fprintf (stderr, "%s - error: curl_multi_init () failed.\n", __func__);
+		return -1;
+	}
+
+	curl_multi_setopt (loop->multi, CURLMOPT_SOCKETFUNCTION, socket_callback);
+	curl_multi_setopt (loop->multi, CURLMOPT_SOCKETDATA, loop);
+	curl_multi_setopt (loop->multi, CURLMOPT_TIMERFUNCTION, timer_callback);
+	curl_multi_setopt (loop->multi, CURLMOPT_TIMERDATA, loop);
+
+	/* tries multiplexed on an HTTP/2 connection, the rest open more */
+	if (ctx->max_streams) {
+		curl_multi_setopt (loop->multi, CURLMOPT_MAX_CONCURRENT_STREAMS, ctx->max_streams);
+	}
+
+	for (i = 0; i < loop->slots_num; i++) {
+		transfer* slot = &loop->slots[i];
+
+		if (!(slot->handle = setup_handle (ctx, slot->error_buffer, &slot->response))) {
+			fprintf (stderr, "%s - error: setup_handle () failed.\n", __func__);
+			return -1;
+		}
+
+		curl_easy_setopt (slot->handle, CURLOPT_PRIVATE, slot);
+
+		loop->free_slots[loop->free_num++] = slot;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Releases everything acquired by loop_init ()
+*
+* Input  -      *loop - the multi loop
+*/
+static void loop_cleanup (multi_loop* loop)
+{
+	long i;
+
+	for (i = 0; loop->slots && i < loop->slots_num; i++) {
+		if (loop->slots[i].handle) {
+			if (loop->multi) {
+				curl_multi_remove_handle (loop->multi, loop->slots[i].handle);
+			}
+			curl_easy_cleanup (loop->slots[i].handle);
+		}
+		validate_state_free (&loop->slots[i].response.validate);
+		arena_free (&loop->slots[i].response.arena);
+	}
+
+	if (loop->multi) {
+		curl_multi_cleanup (loop->multi);
+	}
+
+	if (loop->timerfd != -1) {
+		close (loop->timerfd);
+	}
+
+	if (loop->epfd != -1) {
+		close (loop->epfd);
+	}
+
+	free (loop->free_slots);
+	free (loop->slots);
+	memset (loop, 0, sizeof (multi_loop));
+}
+
+
+/*
+* Description - Picks the url of the next try and hands a slot over to libcurl
+*
+* Input  -      *loop    - the multi loop
+*               *ctx     - the client specific context structure
+*               *slot    - a slot, that is not in flight
+*               intended - monotonic usec, when the try was to be sent
+* Return -      On Success - 0, on Error -1, the slot is back on the free list
+*/
+static int start_transfer (multi_loop* loop, client_context* ctx, transfer* slot,
+		long long intended)
+{
+	long long setup_start = monotonic_nsec ();
+	url_context* url = pick_url (ctx);
+	CURLMcode mres;
+
+	slot->error_buffer[0] = 0;
+	slot->intended = intended;
+
+	if (setup_url (ctx, slot->handle, &slot->response, url, loop->issued) == -1 ||
+			validate_begin (&slot->response.validate, url->validate) == -1) {
+		loop->free_slots[loop->free_num++] = slot;
+		return -1;
+	}
+
+	capture_begin (&slot->response.capture, (uint64_t) loop->issued,
+			url->log_resp_headers, url->log_resp_bodies);
+
+	slot->setup_time = monotonic_nsec () - setup_start;
+	slot->started = monotonic_usec ();
+
+	/* a try is issued, once libcurl has taken it; the slot of a failed
+	   add would never complete */
+	if ((mres = curl_multi_add_handle (loop->multi, slot->handle)) != CURLM_OK) {
+		fprintf (stderr, "%s - error: curl_multi_add_handle () failed: %s\n",
+				__func__, curl_multi_strerror (mres));
+		loop->free_slots[loop->free_num++] = slot;
+		return -1;
+	}
+	loop->issued++;
+
+	return 0;
+}
+
+
+/*
+* Description - Starts the tries, whose scheduled time has come, while there
+*               are free slots. Tries, that have found no free slot, keep
+*               their scheduled time and are started later.
+*
+* Input  -      *loop - the multi loop
+*               *ctx  - the client specific context structure
+* Return -      On Success - 0, on Error -1
+*/
+static int start_scheduled (multi_loop* loop, client_context* ctx)
+{
+	long long now = monotonic_usec ();
+
+	while (loop->free_num && loop->next_send <= (double) now &&
+			!run_is_over (ctx, loop->issued)) {
+		if (start_transfer (loop, ctx, loop->free_slots[--loop->free_num],
+					(long long) loop->next_send) == -1) {
+			return -1;
+		}
+		loop->next_send += next_interval (loop, ctx);
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Arms the send timer to the next scheduled try. When there are
+*               no free slots, the timer is disarmed: the try is started on a
+*               completion instead.
+*
+* Input  -      *loop - the multi loop
+*               *ctx  - the client specific context structure
+*/
+static void arm_send_timer (multi_loop* loop, client_context* ctx)
+{
+	struct itimerspec its;
+
+	memset (&its, 0, sizeof (its));
+
+	if (loop->free_num && !run_is_over (ctx, loop->issued)) {
+		long long at = (long long) loop->next_send;
+
+		/* a zero it_value would disarm the timer */
+		if (at <= 0) {
+			at = 1;
+		}
+
+		its.it_value.tv_sec = at / 1000000;
+		its.it_value.tv_nsec = (at % 1000000) * 1000;
+	}
+
+	timerfd_settime (loop->timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+
+/*
+* Description - Time to the next scheduled try, drawn from the configured
+*               inter-arrival distribution
+*
+* Input  -      *loop - the multi loop
+*               *ctx  - the client specific context structure
+* Return -      Inter-arrival time in usec
+*/
+static double next_interval (multi_loop* loop, client_context* ctx)
+{
+	if (ctx->arrival == ARRIVAL_POISSON) {
+		/* exponential inter-arrival times make a Poisson process */
+		return -log (1.0 - rng_double (&ctx->rng)) * loop->interval;
+	}
+
+	return loop->interval;
+}
+
+
+/*
+* Description - Measures the scheduling lag of the loop: how much later than
+*               asked for it woke up for the earliest due timer, the one of
+*               libcurl or the next scheduled send. The loop wakes up late,
+*               when the worker is busy, or when its thread waits for a cpu.
+*
+* Input  -      *loop   - the multi loop
+*               *ctx    - the client specific context structure
+*               before  - monotonic usec, when the loop started to wait
+*               wait_ms - the timeout of the wait, -1 for none
+*/
+static void measure_lag (multi_loop* loop, client_context* ctx, long long before,
+		int wait_ms)
+{
+	long long due = loop->timer_deadline;
+	long long wake;
+	long long now;
+
+	if (loop->open_loop && loop->free_num && !run_is_over (ctx, loop->issued) &&
+			(due < 0 || (long long) loop->next_send < due)) {
+		due = (long long) loop->next_send;
+	}
+
+	if (due < 0 || (now = monotonic_usec ()) < due) {
+		/* woken up by a socket, no timer was due */
+		return;
+	}
+
+	/* the timeout is rounded up to msec, the loop is not late for that */
+	wake = wait_ms > 0 && before + wait_ms * 1000LL > due ? before + wait_ms * 1000LL : due;
+
+	selfmon_lag (ctx->mon, now > wake ? now - wake : 0);
+}
+
+
+/*
+* Description - libcurl socket callback. Mirrors the socket interest of
+*               libcurl to the epoll set.
+*
+* Input  -      s       - the socket
+*               what    - CURL_POLL_IN/OUT/INOUT/REMOVE
+*               *userp  - the multi loop
+*               *socketp - NULL, when the socket is not in the epoll set yet
+* Return -      0
+*/
+static int
+socket_callback (CURL* handle, curl_socket_t s, int what, void* userp, void* socketp)
+{
+	multi_loop* loop = (multi_loop *) userp;
+	struct epoll_event ev;
+	(void)handle;
+
+	if (what == CURL_POLL_REMOVE) {
+		epoll_ctl (loop->epfd, EPOLL_CTL_DEL, s, NULL);
+		return 0;
+	}
+
+	memset (&ev, 0, sizeof (ev));
+	ev.data.fd = s;
+
+	if (what & CURL_POLL_IN) {
+		ev.events |= EPOLLIN;
+	}
+	if (what & CURL_POLL_OUT) {
+		ev.events |= EPOLLOUT;
+	}
+
+	if (socketp) {
+		epoll_ctl (loop->epfd, EPOLL_CTL_MOD, s, &ev);
+	} else if (epoll_ctl (loop->epfd, EPOLL_CTL_ADD, s, &ev) == 0) {
+		/* mark the socket as known to the epoll set */
+		curl_multi_assign (loop->multi, s, loop);
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - libcurl timer callback. Stores the deadline to be used by the
+*               next epoll_wait ().
+*
+* Input  -      timeout_ms - timeout in msec, -1 deletes the timer
+*               *userp     - the multi loop
+* Return -      0
+*/
+static int
+timer_callback (CURLM* multi, long timeout_ms, void* userp)
+{
+	multi_loop* loop = (multi_loop *) userp;
+	(void)multi;
+
+	loop->timer_deadline = timeout_ms < 0 ? -1 :
+		monotonic_usec () + (long long) timeout_ms * 1000;
+
+	return 0;
+}
+
+
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,86 @@
+/*
+ *     multi_loop.h
+ *
+ */
+#ifndef MULTI_LOOP_H
+#define MULTI_LOOP_H
+
+#include <curl/curl.h>
+
+#include "conf.h"
+
+/* Maximum number of socket events handled by a single epoll_wait () */
+#define MULTI_LOOP_MAX_EVENTS 64
+
+/* Slots of a worker in the open loop (RATE), when CONCURRENCY is not set */
+#define MULTI_LOOP_OPEN_CONCURRENCY 256
+
+/* A transfer slot of the multi loop: an easy handle, that is configured once
+   and re-added to the multi handle for each of its tries.  */
+typedef struct transfer {
+
+	/* Library handle of the slot */
+	CURL* handle;
+
+	/* Per-slot error buffer, libcurl writes into it during the transfer */
+	char error_buffer[CURL_ERROR_SIZE];
+
+	/* State of the response callbacks of the slot handle */
+	response_ctx response;
+
+	/* Monotonic usec, when the try was scheduled to be sent */
+	long long intended;
+
+	/* Monotonic usec, when the try was handed over to libcurl */
+	long long started;
+
+	/* Nsec the try took to set the handle up */
+	long long setup_time;
+
+} transfer;
+
+/* Event loop, driving all the slots through a single multi handle */
+typedef struct multi_loop {
+
+	/* The multi handle, all the slots are added to */
+	CURLM* multi;
+
+	/* epoll descriptor, watching the sockets libcurl asks for */
+	int epfd;
+
+	/* Monotonic time in usec, when the timeout requested by libcurl via
+	   the timer callback expires, -1 for none */
+	long long timer_deadline;
+
+	/* Transfer slots, there are <slots_num> of them */
+	transfer* slots;
+	long slots_num;
+
+	/* Flag; when true, tries are sent on the schedule of ctx->rate */
+	int open_loop;
+
+	/* timerfd in the epoll set, that fires at the next scheduled send */
+	int timerfd;
+
+	/* Monotonic usec, when the next try is scheduled to be sent */
+	double next_send;
+
+	/* Mean inter-arrival time of the scheduled tries, usec */
+	double interval;
+
+	/* Stack of the slots, that are not in flight */
+	transfer** free_slots;
+	long free_num;
+
+	/* Tries handed over to libcurl so far and tries completed */
+	long issued;
+	long completed;
+
+} multi_loop;
+
+/* Fetches urls until the run is over keeping ctx->concurrency of them in
+   flight. The tries are recorded to the statistics shard of <ctx>.  */
+int run_multi_loop (client_context* ctx);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,177 @@
+/*
+ *     payload.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "payload.h"
+
+
+/*
+* Description - Maps a body file read-only for the whole run. The pages are
+*               populated now, not on a page fault during the run. The
+*               {{placeholders}} of the body, if any, are compiled; the
+*               literal parts of the template point into the mapping.
+*
+* Input  -      *p    - the payload to map
+*               *path - path of the file
+* Return -      On Success - 0, on Error -1
+*/
+int payload_map (payload* p, const char* path)
+{
+	struct stat st;
+	void* map;
+	int fd;
+
+	memset (p, 0, sizeof (payload));
+
+	if ((fd = open (path, O_RDONLY)) == -1) {
+		fprintf (stderr, "%s - error: open() failed to open \"%s\", errno %d.\n",
+				__func__, path, errno);
+		return -1;
+	}
+
+	if (fstat (fd, &st) == -1) {
+		fprintf (stderr, "%s - error: fstat() failed for \"%s\", errno %d.\n",
+				__func__, path, errno);
+		close (fd);
+		return -1;
+	}
+
+	/* an empty body can not be mapped */
+	if (st.st_size == 0) {
+		map = "";
+	} else if ((map = mmap (NULL, (size_t) st.st_size, PROT_READ,
+					MAP_PRIVATE | MAP_POPULATE, fd, 0)) == MAP_FAILED) {
+		fprintf (stderr, "%s - error: mmap() of %lld bytes of \"%s\" failed, errno %d.\n",
+				__func__, (long long) st.st_size, path, errno);
+		close (fd);
+		return -1;
+	}
+
+	/* the mapping keeps the file */
+	close (fd);
+
+	if (!(p->path = strdup (path))) {
+		fprintf (stderr, "%s - error: allocation failed for \"%s\".\n", __func__, path);
+		if (st.st_size) {
+			munmap (map, (size_t) st.st_size);
+		}
+		return -1;
+	}
+
+	p->data = (const char *) map;
+	p->size = (size_t) st.st_size;
+
+	/* a binary body may have "{{" of its own, that is left as it is */
+	if (tmpl_compile (&p->body, p->data, p->size, 0) == -1) {
+		if (st.st_size) {
+			munmap (map, (size_t) st.st_size);
+		}
+		free (p->path);
+		p->path = NULL;
+		p->data = NULL;
+		p->size = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Starts reading a body of a try from its first byte
+*
+* Input  -      *r    - upload state of a handle
+*               *data - the body of the try, NULL for none
+*               size  - size of the body
+*/
+void payload_reader_begin (payload_reader* r, const char* data, size_t size)
+{
+	r->data = data;
+	r->size = size;
+	r->offset = 0;
+}
+
+
+/*
+* Description - Hands the next part of the body over to libcurl. The copy
+*               into the upload buffer is the only one; the body itself is
+*               shared by all the tries in flight.
+*
+* Input  -      *buffer - upload buffer of libcurl
+*               size    - always 1
+*               nitems  - size of the buffer
+*               *userp  - upload state of the handle
+* Return -      Bytes copied, 0 at the end of the body
+*/
+size_t payload_read (char* buffer, size_t size, size_t nitems, void* userp)
+{
+	payload_reader* r = (payload_reader *) userp;
+	size_t len = size * nitems;
+
+	if (!r->data || r->offset >= r->size) {
+		return 0;
+	}
+
+	if (len > r->size - r->offset) {
+		len = r->size - r->offset;
+	}
+
+	memcpy (buffer, r->data + r->offset, len);
+	r->offset += len;
+
+	return len;
+}
+
+
+/*
+* Description - Moves the position in the body, when libcurl has to send it
+*               again, e.g. after a redirect
+*
+* Input  -      *userp - upload state of the handle
+*               offset - the new position
+*               origin - SEEK_SET, SEEK_CUR or SEEK_END
+* Return -      CURL_SEEKFUNC_OK or CURL_SEEKFUNC_FAIL
+*/
+int payload_seek (void* userp, curl_off_t offset, int origin)
+{
+	payload_reader* r = (payload_reader *) userp;
+	curl_off_t pos;
+
+	if (!r->data) {
+		return CURL_SEEKFUNC_FAIL;
+	}
+
+	switch (origin) {
+	case SEEK_SET:
+		pos = offset;
+		break;
+	case SEEK_CUR:
+		pos = (curl_off_t) r->offset + offset;
+		break;
+	case SEEK_END:
+		pos = (curl_off_t) r->size + offset;
+		break;
+	default:
+		return CURL_SEEKFUNC_FAIL;
+	}
+
+	if (pos < 0 || pos > (curl_off_t) r->size) {
+		return CURL_SEEKFUNC_FAIL;
+	}
+
+	r->offset = (size_t) pos;
+
+	return CURL_SEEKFUNC_OK;
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
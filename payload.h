@@ -0,0 +1,56 @@
+/*
+ *     payload.h
+ *
+ */
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <stddef.h>
+#include <curl/curl.h>
+
+#include "tmpl.h"
+
+/* A request body, a file mapped read-only for the whole run. The mapping is
+   shared by all the workers and handles, nothing of it is copied per try.  */
+typedef struct payload {
+
+	/* Path of the file, as given by BODY_FILE */
+	char* path;
+
+	/* The mapped file, an empty string for an empty file */
+	const char* data;
+
+	/* Size of the file */
+	size_t size;
+
+	/* Placeholders of the body, rendered per try when there are any */
+	tmpl body;
+
+} payload;
+
+/* Upload state of a handle, a position in the body of the current try */
+typedef struct payload_reader {
+
+	/* Body of the current try, the mapped file or its rendering */
+	const char* data;
+	size_t size;
+
+	/* Bytes of the body handed over to libcurl */
+	size_t offset;
+
+} payload_reader;
+
+/* Maps the file at <path> and compiles its placeholders */
+int payload_map (payload* p, const char* path);
+
+/* Starts reading a body from its first byte */
+void payload_reader_begin (payload_reader* r, const char* data, size_t size);
+
+/* CURLOPT_READFUNCTION, copies the body into the upload buffer of libcurl */
+size_t payload_read (char* buffer, size_t size, size_t nitems, void* userp);
+
+/* CURLOPT_SEEKFUNCTION, rewinds the body for a resend */
+int payload_seek (void* userp, curl_off_t offset, int origin);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,292 @@
+/*
+ *     report.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "conf.h"
+#include "stats.h"
+#include "run_context.h"
+#include "worker.h"
+#include "report.h"
+#include "selfmon.h"
+
+/* forward declaration */
+static int report_open (client_context* ctx);
+static void report_interval (client_context* ctx, worker* workers, int workers_num,
+		stats* interval, long long now, struct rusage* usage);
+static long long usage_usec (const struct timeval* tv);
+static void print_errors (FILE* fp, const stats* s);
+static void sleep_usec (long long usec);
+
+
+/*
+* Description - Runs in the main thread, while the workers are loading. Each
+*               REPORT_INTERVAL swaps the interval buffers of the workers,
+*               merges them and writes a line to <run-name>.stat. The last,
+*               partial interval is written when the workers have finished.
+*               The workers never wait for the reporter.
+*
+* Input  -      *ctx        - the client context of the run
+*               *workers    - array of the started workers
+*               workers_num - number of the workers
+* Return -      On Success - 0, on Error -1
+*/
+int report_run (client_context* ctx, worker* workers, int workers_num)
+{
+	long long interval_usec = (long long) ctx->report_interval * 1000;
+	long long next_report;
+	long long now;
+	stats interval;
+	struct rusage usage;
+
+	if (report_open (ctx) == -1) {
+		return -1;
+	}
+
+	if (stats_init (&interval, ctx->hist_precision) == -1) {
+		fprintf (stderr, "%s - error: stats_init () failed.\n", __func__);
+		fclose (ctx->statistics_file);
+		ctx->statistics_file = NULL;
+		return -1;
+	}
+
+	getrusage (RUSAGE_SELF, &usage);
+	ctx->last_measure = ctx->start_time;
+	next_report = ctx->start_time + interval_usec;
+
+	while (!workers_done (workers, workers_num)) {
+		now = monotonic_usec ();
+
+		if (now < next_report) {
+			sleep_usec (next_report - now < REPORT_POLL_USEC ?
+					next_report - now : REPORT_POLL_USEC);
+			continue;
+		}
+
+		report_interval (ctx, workers, workers_num, &interval, now, &usage);
+		next_report += interval_usec;
+	}
+
+	report_interval (ctx, workers, workers_num, &interval, monotonic_usec (), &usage);
+
+	stats_free (&interval);
+	fclose (ctx->statistics_file);
+	ctx->statistics_file = NULL;
+
+	return 0;
+}
+
+
+/*
+* Description - Opens <run-name>.stat and writes the header line
+*
+* Input  -      *ctx - the client context of the run
+* Return -      On Success - 0, on Error -1
+*/
+static int report_open (client_context* ctx)
+{
+	snprintf (ctx->runtime_statistics, sizeof (ctx->runtime_statistics), "%.*s.stat",
+			(int) sizeof (ctx->runtime_statistics) - 6,
+			ctx->run_name[0] ? ctx->run_name : "samk");
+
+	if (!(ctx->statistics_file = fopen (ctx->runtime_statistics, "w"))) {
+		fprintf (stderr, "%s - error: fopen() failed to open for writing \"%s\", errno %d.\n",
+				__func__, ctx->runtime_statistics, errno);
+		return -1;
+	}
+
+	fprintf (ctx->statistics_file, "# secs, tries, tries/sec, HTTP errors, bad bodies, "
+			"transfer errors, status: 1xx, 2xx, 3xx, 4xx, 5xx, none, "
+			"transfer errors by CURLcode (code:tries ...), %s msec: p50, p90, p99, p99.9, max, "
+			"cpu %%: user, sys, worker max, worker runqueue wait max, context switches: voluntary, involuntary, "
+			"loop lag msec: mean, max, per try: cycles, instructions, valid\n",
+			stats_phase_name (PHASE_RESPONSE));
+	fflush (ctx->statistics_file);
+
+	return 0;
+}
+
+
+/*
+* Description - Collects the interval statistics of the workers and writes
+*               them as a line of the statistics file, with the cost of the
+*               client itself in the interval. An interval, that a worker
+*               was saturated in, is marked as not valid: its latency
+*               includes the time the tries have waited for samk.
+*
+* Input  -      *ctx        - the client context of the run
+*               *workers    - array of the workers
+*               workers_num - number of the workers
+*               *interval   - the statistics to merge to, reset after writing
+*               now         - monotonic usec of the interval end
+*               *usage      - resource usage of the process at the interval
+*                             start, updated to its end
+*/
+static void report_interval (client_context* ctx, worker* workers, int workers_num,
+		stats* interval, long long now, struct rusage* usage)
+{
+	long long duration = now - (long long) ctx->last_measure;
+	const hist* h = &interval->phase[PHASE_RESPONSE];
+	long long lag_num = 0, lag_sum = 0, lag_max = 0;
+	long long cycles = 0, instructions = 0;
+	long long cpu_max = 0, wait_max = 0, busy_max = 0;
+	int perf = 1;
+	struct rusage last = *usage;
+	selfmon_sample sample;
+	double busiest;
+	int valid;
+	int i;
+
+	for (i = 0; i < workers_num; i++) {
+		stats* done;
+
+		selfmon_read (&workers[i].mon, workers[i].thread, &sample);
+
+		if (sample.cpu > cpu_max) {
+			cpu_max = sample.cpu;
+		}
+		if (sample.wait > wait_max) {
+			wait_max = sample.wait;
+		}
+		/* a worker waiting for a cpu is as saturated, as a busy one */
+		if (sample.cpu + sample.wait > busy_max) {
+			busy_max = sample.cpu + sample.wait;
+		}
+		if (sample.lag_max > lag_max) {
+			lag_max = sample.lag_max;
+		}
+		lag_num += sample.lag_num;
+		lag_sum += sample.lag_sum;
+
+		if (sample.cycles < 0 || sample.instructions < 0) {
+			perf = 0;
+		}
+		cycles += sample.cycles;
+		instructions += sample.instructions;
+
+		if (!workers[i].shard.interval) {
+			continue;
+		}
+
+		done = interval_recorder_swap (workers[i].shard.interval);
+		stats_merge (interval, done);
+		stats_reset (done);
+	}
+
+	getrusage (RUSAGE_SELF, usage);
+
+	busiest = duration > 0 ? (double) busy_max / duration : 0.0;
+	valid = busiest < SELFMON_CPU_SATURATED &&
+		(!lag_num || lag_sum / lag_num < SELFMON_LAG_SATURATED_USEC);
+
+	fprintf (ctx->statistics_file, "%.3f, %lld, %.1f, %lld, %lld, ",
+			(double) (now - (long long) ctx->start_time) / 1000000,
+			interval->tries,
+			duration > 0 ? (double) interval->tries * 1000000 / duration : 0.0,
+			interval->errors,
+			interval->bad_bodies);
+
+	print_errors (ctx->statistics_file, interval);
+
+	fprintf (ctx->statistics_file, "%.3f, %.3f, %.3f, %.3f, %.3f, "
+			"%.1f, %.1f, %.1f, %.1f, %ld, %ld, %.3f, %.3f, ",
+			(double) hist_value_at_percentile (h, 50.0) / 1000,
+			(double) hist_value_at_percentile (h, 90.0) / 1000,
+			(double) hist_value_at_percentile (h, 99.0) / 1000,
+			(double) hist_value_at_percentile (h, 99.9) / 1000,
+			(double) h->max / 1000,
+			duration > 0 ? (double) (usage_usec (&usage->ru_utime) -
+				usage_usec (&last.ru_utime)) * 100 / duration : 0.0,
+			duration > 0 ? (double) (usage_usec (&usage->ru_stime) -
+				usage_usec (&last.ru_stime)) * 100 / duration : 0.0,
+			duration > 0 ? (double) cpu_max * 100 / duration : 0.0,
+			duration > 0 ? (double) wait_max * 100 / duration : 0.0,
+			usage->ru_nvcsw - last.ru_nvcsw,
+			usage->ru_nivcsw - last.ru_nivcsw,
+			lag_num ? (double) lag_sum / lag_num / 1000 : 0.0,
+			(double) lag_max / 1000);
+
+	if (perf && interval->tries) {
+		fprintf (ctx->statistics_file, "%.0f, %.0f, %d\n",
+				(double) cycles / interval->tries,
+				(double) instructions / interval->tries, valid);
+	} else {
+		fprintf (ctx->statistics_file, "-, -, %d\n", valid);
+	}
+
+	ctx->intervals_num++;
+
+	if (!valid) {
+		ctx->intervals_saturated++;
+		fprintf (stderr, "%s - warning: samk is saturated at %.3f secs, busiest worker "
+				"%.0f%% running or waiting for a cpu, loop lag %.3f msec mean; the latency of the interval "
+				"is not valid.\n", __func__,
+				(double) (now - (long long) ctx->start_time) / 1000000, busiest * 100,
+				lag_num ? (double) lag_sum / lag_num / 1000 : 0.0);
+	}
+
+	/* so that the file can be followed during the run */
+	fflush (ctx->statistics_file);
+
+	ctx->last_measure = now;
+	stats_reset (interval);
+}
+
+
+/*
+* Description - Writes the failed transfers and the status classes of an
+*               interval, then the count of each CURLcode, "-" for none
+*
+* Input  -      *fp - the statistics file
+*               *s  - the statistics of the interval
+*/
+static void print_errors (FILE* fp, const stats* s)
+{
+	int any = 0;
+	int i;
+
+	fprintf (fp, "%lld, %lld, %lld, %lld, %lld, %lld, %lld, ", s->failures,
+			s->status_classes[1], s->status_classes[2], s->status_classes[3],
+			s->status_classes[4], s->status_classes[5], s->status_classes[0]);
+
+	for (i = 1; i < CURL_LAST; i++) {
+		if (s->curl_codes[i]) {
+			fprintf (fp, "%s%d:%lld", any ? " " : "", i, s->curl_codes[i]);
+			any = 1;
+		}
+	}
+
+	fprintf (fp, "%s, ", any ? "" : "-");
+}
+
+
+/* usec of a time of the resource usage */
+static long long usage_usec (const struct timeval* tv)
+{
+	return (long long) tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+
+/*
+* Description - Sleeps, resuming the sleep on signals
+*
+* Input  -      usec - time to sleep
+*/
+static void sleep_usec (long long usec)
+{
+	struct timespec ts;
+
+	ts.tv_sec = usec / 1000000;
+	ts.tv_nsec = (usec % 1000000) * 1000;
+
+	while (nanosleep (&ts, &ts) == -1 && errno == EINTR) {
+		;
+	}
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,19 @@
+/*
+ *     report.h
+ *
+ */
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "conf.h"
+#include "worker.h"
+
+/* Longest sleep of the reporter, so that the end of the run is noticed soon */
+#define REPORT_POLL_USEC 100000
+
+/* Writes the interval statistics of the running workers to <run-name>.stat
+   each REPORT_INTERVAL msec, until all the workers have finished */
+int report_run (client_context* ctx, worker* workers, int workers_num);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
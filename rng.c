@@ -0,0 +1,105 @@
+/*
+ *     rng.c
+ *
+ */
+#include <stdint.h>
+
+#include "rng.h"
+
+/* forward declaration */
+static uint64_t splitmix64 (uint64_t* x);
+static uint64_t rotl (uint64_t x, int k);
+
+
+/*
+* Description - Seeds the generator. The state is expanded from the seed by
+*               splitmix64, so that close seeds give unrelated sequences.
+*
+* Input  -      *rng - the generator
+*               seed - the seed
+*/
+void rng_seed (rng_state* rng, uint64_t seed)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		rng->s[i] = splitmix64 (&seed);
+	}
+}
+
+
+/*
+* Description - Advances the generator
+*
+* Input  -      *rng - the generator
+* Return -      Next 64 random bits
+*/
+uint64_t rng_next (rng_state* rng)
+{
+	uint64_t* s = rng->s;
+	const uint64_t result = rotl (s[1] * 5, 7) * 9;
+	const uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+
+	s[2] ^= t;
+	s[3] = rotl (s[3], 45);
+
+	return result;
+}
+
+
+/*
+* Description - Uniform double, made of the upper 53 random bits
+*
+* Input  -      *rng - the generator
+* Return -      Value in [0, 1)
+*/
+double rng_double (rng_state* rng)
+{
+	return (double) (rng_next (rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/*
+* Description - Uniform integer in a closed range, by Lemire's multiply-shift
+*               reduction. Its bias is negligible for the ranges used here.
+*
+* Input  -      *rng - the generator
+*               low  - lowest value
+*               high - highest value, not below <low>
+* Return -      Value in [low, high]
+*/
+uint64_t rng_range (rng_state* rng, uint64_t low, uint64_t high)
+{
+	uint64_t span = high - low + 1;
+
+	if (!span) {
+		/* the full 64 bits range */
+		return rng_next (rng);
+	}
+
+	return low + (uint64_t) (((unsigned __int128) rng_next (rng) * span) >> 64);
+}
+
+
+static uint64_t splitmix64 (uint64_t* x)
+{
+	uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+
+static uint64_t rotl (uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
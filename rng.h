@@ -0,0 +1,29 @@
+/*
+ *     rng.h
+ *
+ */
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* State of a xoshiro256** pseudo random generator. Not shared among
+   threads, each worker keeps its own one.  */
+typedef struct rng_state {
+	uint64_t s[4];
+} rng_state;
+
+/* Seeds the generator, the same seed gives the same sequence */
+void rng_seed (rng_state* rng, uint64_t seed);
+
+/* Next 64 random bits */
+uint64_t rng_next (rng_state* rng);
+
+/* Uniform double in [0, 1) */
+double rng_double (rng_state* rng);
+
+/* Uniform integer in [low, high] */
+uint64_t rng_range (rng_state* rng, uint64_t low, uint64_t high);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
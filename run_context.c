@@ -8,13 +8,21 @@
 
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
 #include <curl/curl.h>
 
 #include "conf.h"
 #include "url.h"
 #include "run_context.h"
+#include "share.h"
+#include "trace.h"
+#include "alloc.h"
 
-#define MAX_HEADER_LEN 50
+
+/* Set, when the error rate of a worker has gone above MAX_ERROR_RATE; all
+   the workers stop issuing tries  */
+static atomic_int run_aborted;
 
 /* forward declaration */
 static int
@@ -22,8 +30,14 @@ debug_callback(CURL *handle, curl_infotype type, char *data, size_t size, void *
 //static size_t 
 //writefunction( void *ptr, size_t size, size_t nmemb, void *stream);
 static size_t 
-do_nothing_write_func (void *ptr, size_t size, size_t nmemb, void *stream);
-static int setup_handle_appl (struct client_context* const ctx);
+response_write_func (void *ptr, size_t size, size_t nmemb, void *userp);
+static size_t 
+response_header_func (char *ptr, size_t size, size_t nmemb, void *userp);
+static int setup_handle_appl (client_context* const ctx, CURL* handle, url_context* url);
+static int setup_body (CURL* handle, response_ctx* response, url_context* url,
+		const tmpl_vars* vars);
+static int setup_headers (client_context* ctx, CURL* handle, response_ctx* response,
+		url_context* url, const tmpl_vars* vars);
 
 /*
 * Description - Gets the statistics info from the run 
@@ -33,184 +47,663 @@ static int setup_handle_appl (struct client_context* const ctx);
 */
 int get_stats_info (client_context *ctx) {
 
-	curl_off_t val;
-	long response_status = 0;
 	int res;
-	char *ip;
 
 	if (!ctx) {
 		return -1;
 	}
 
+	long long setup_start = monotonic_nsec ();
+
 	ctx->error_buffer[0] = 0;
+	ctx->st.send_time = monotonic_usec () - (long long) ctx->start_time;
+	ctx->url = pick_url (ctx);
 
-	if (setup_init (ctx) == -1) {
-		fprintf (stderr,"%s - error: setup init failed.\n",__func__);
+	/* The handle is kept from the previous tries, together with its
+	   connection and DNS caches. Only the per-try options are applied.  */
+	if (setup_url (ctx, ctx->handle, &ctx->response, ctx->url, ctx->current_run) == -1) {
+		fprintf (stderr,"%s - error: setup_url () failed.\n",__func__);
 		return -1;
 	}
 
-	res = curl_easy_perform(ctx->handle);
+	capture_begin (&ctx->response.capture, (uint64_t) ctx->current_run,
+			ctx->url->log_resp_headers, ctx->url->log_resp_bodies);
+
+	if (validate_begin (&ctx->response.validate, ctx->url->validate) == -1) {
+		return -1;
+	}
 
-	/* if the request did not complete correctly, show the error
-	   information. if no detailed error information was written to errbuf
-	   show the more generic information from curl_easy_strerror instead.  */
+	ctx->st.setup_time = monotonic_nsec () - setup_start;
 
-	if (res != CURLE_OK) {
+	res = curl_easy_perform(ctx->handle);
 
-		size_t len = strlen(ctx->error_buffer);
+	/* a failed transfer is a result of the try as well, it is counted and
+	   the run goes on  */
+	if (res != CURLE_OK) {
+		report_failed_try (ctx, ctx->error_buffer, res);
+	}
 
-		if (len) {
-			fprintf(stderr, "%s%s", ctx->error_buffer,
-					((ctx->error_buffer[len - 1] != '\n') ? "\n" : ""));
-		} else {
-			fprintf(stderr, "%s\n", curl_easy_strerror(res));
-		}
+	ctx->st.url_id = ctx->url->id;
+	ctx->st.key_rank = ctx->response.key_rank;
 
+	if (collect_stats (ctx, ctx->handle, res, &ctx->st) == -1) {
 		return -1;
 	}
 
-	if (CURLE_OK == res) {
-		/* total time for the execution */
-		res = curl_easy_getinfo(ctx->handle, CURLINFO_TOTAL_TIME_T, &val);
+	capture_end (&ctx->response.capture, ctx->st.resp_code);
 
-		if ((CURLE_OK == res) && (val>0)) {
-			ctx->st.total_time = val;
-		}  else {
-			fprintf(stderr, "Error geting info total time '%s' : %s\n", 
-					ctx->url.url_str, curl_easy_strerror(res));
+	/* HTTP errors are counted on their own, their bodies are not checked */
+	ctx->st.bad_body = res == CURLE_OK && ctx->st.resp_code < 400 &&
+		!validate_end (&ctx->response.validate);
 
+	return 0; 
+}
+
+
+/*
+* Description - Fetches the url until the run is over, one try after another.
+*               The tries are recorded to the statistics shard of the context.
+*
+* Input  -      *ctx - the client specific context structure
+* Return -      On Success - 0, on Error -1
+*/
+int run_serial_loop (client_context *ctx) {
+
+	if (setup_init (ctx) == -1) {
+		fprintf (stderr,"%s - error: init failed.\n",__func__);
+		return -1;
+	}
+
+	/* get the stats, for x number of runs */
+	while (!run_is_over (ctx, ctx->current_run)) {
+
+		if (get_stats_info(ctx) != 0) {
+			release_init (ctx);
 			return -1;
 		}
+
+		stats_shard_record (ctx->shard, &ctx->st);
+
+		if (ctx->trace_ring) {
+			trace_ring_push (ctx->trace_ring, &ctx->st);
+		}
+
+		ctx->current_run++ ;
+		count_allocs (ctx);
+		check_error_rate (ctx);
 	}
 
-	/* check for name resolution time */ 
-	res = curl_easy_getinfo(ctx->handle, CURLINFO_NAMELOOKUP_TIME_T, &val);
+	release_init (ctx);
+
+	return 0;
+}
+
+
+/*
+* Description - Picks the url of the next try by the weights of the urls
+*
+* Input  -      *ctx - the client specific context structure
+* Return -      The url
+*/
+url_context* pick_url (client_context *ctx) {
+
+	if (ctx->urls_num == 1) {
+		return &ctx->urls[0];
+	}
+
+	return &ctx->urls[alias_pick (&ctx->url_picker, &ctx->rng)];
+}
+
+
+/*
+* Description - Counts the allocations by libcurl in the steady state of the
+*               worker, after a completed try. The count starts, when the
+*               warm-up tries are over.
+*
+* Input  -      *ctx - the client specific context structure
+*/
+void count_allocs (client_context *ctx) {
+
+	if (ctx->current_run == ctx->alloc_warmup) {
+		ctx->allocs_warm = alloc_count ();
+	} else if (ctx->current_run > ctx->alloc_warmup) {
+		ctx->allocs_steady = alloc_count () - ctx->allocs_warm;
+	}
+}
+
+
+/*
+* Description - Counts the failed tries of the worker in windows of
+*               ERROR_RATE_WINDOW tries. The run is aborted, when the failed
+*               share of a window is above MAX_ERROR_RATE; the tries in flight
+*               still complete and are reported.
+*
+* Input  -      *ctx - the client specific context structure, with the
+*                      results of the try just recorded
+*/
+void check_error_rate (client_context *ctx) {
+
+	if (!ctx->max_error_rate) {
+		return;
+	}
+
+	ctx->window_failed += stats_try_failed (&ctx->st);
+
+	if (++ctx->window_tries < ERROR_RATE_WINDOW) {
+		return;
+	}
+
+	if (ctx->window_failed * 100.0 > ctx->max_error_rate * ctx->window_tries &&
+			!atomic_exchange (&run_aborted, 1)) {
+		fprintf (stderr, "%s - error: %ld of the last %ld tries of worker %d have failed, "
+				"above MAX_ERROR_RATE of %g%%; the run is aborted.\n", __func__,
+				ctx->window_failed, ctx->window_tries, ctx->worker_id, ctx->max_error_rate);
+	}
+
+	ctx->window_tries = ctx->window_failed = 0;
+}
+
+
+/*
+* Description - Tells, whether the run has been aborted by its error rate
+*
+* Return -      1 when aborted, 0 otherwise
+*/
+int run_was_aborted (void) {
+
+	return atomic_load (&run_aborted);
+}
+
 
-	if ((CURLE_OK == res) && (val>0)) {
-		ctx->st.namelookup_time = val;
+/*
+* Description - Tells, whether the run is over: the tries of the context are
+*               issued, the run time has elapsed or the run is aborted. Zero
+*               num_tries or run_time do not limit the run.
+*
+* Input  -      *ctx   - the client specific context structure
+*               issued - number of the tries issued so far
+* Return -      1 when the run is over, 0 otherwise
+*/
+int run_is_over (client_context *ctx, long issued) {
+
+	if (atomic_load_explicit (&run_aborted, memory_order_relaxed)) {
+		return 1;
+	}
+
+	if (ctx->num_tries && issued >= ctx->num_tries) {
+		return 1;
+	}
+
+	if (ctx->run_time &&
+			monotonic_usec () >= (long long) (ctx->start_time + ctx->run_time * 1000)) {
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Reads the monotonic clock
+*
+* Return -      Current monotonic time in usec
+*/
+long long monotonic_usec (void) {
+
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+* Description - Reads the monotonic clock, for the short costs of samk itself
+*
+* Return -      Current monotonic time in nsec
+*/
+long long monotonic_nsec (void) {
+
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	return (long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/*
+* Description - Reports the failed transfer of a try. Only the first failure
+*               of each CURLcode in the worker is printed, under load the
+*               rest are counted by the statistics.
+*
+* Input  -      *ctx          - the client specific context structure
+*               *error_buffer - error buffer attached to the handle
+*               res           - result code of the transfer
+*/
+void report_failed_try (client_context *ctx, const char *error_buffer, CURLcode res) {
+
+	if (res < CURL_LAST && ctx->shard->all.curl_codes[res]) {
+		return;
+	}
+
+	fprintf (stderr, "worker %d: ", ctx->worker_id);
+	report_transfer_error (error_buffer, res);
+}
+
+
+/*
+* Description - Prints the error of a failed transfer. Prefers the detailed
+*               message in the handle error buffer, falls back to the generic
+*               curl_easy_strerror () text.
+*
+* Input  -      *error_buffer - error buffer attached to the handle
+*               res           - result code of the transfer
+*/
+void report_transfer_error (const char *error_buffer, CURLcode res) {
+
+	size_t len = strlen(error_buffer);
+
+	if (len) {
+		fprintf(stderr, "%s%s", error_buffer,
+				((error_buffer[len - 1] != '\n') ? "\n" : ""));
+	} else {
+		fprintf(stderr, "%s\n", curl_easy_strerror(res));
+	}
+}
+
+
+/*
+* Description - Collects the timing and result info of a finished transfer.
+*               A failed transfer has the phases, that it got to, the rest
+*               are zero; so are the lookup and connect of a reused
+*               connection or of an address given by number.
+*
+* Input  -      *ctx    - the client specific context structure
+*               *handle - the handle, that has finished the transfer
+*               result  - CURLcode of the transfer
+* Output -      *st     - filled with the statistics of the transfer
+* Return -      On Success - 0, on Error -1
+*/
+int collect_stats (client_context *ctx, CURL *handle, CURLcode result, client_stats *st) {
+
+	/* phases read as they are, beyond the ones checked one by one below */
+	static const struct {
+		CURLINFO info;
+		stat_phase phase;
+	} more_phases[] = {
+		{ CURLINFO_APPCONNECT_TIME_T, PHASE_APPCONNECT },
+		{ CURLINFO_PRETRANSFER_TIME_T, PHASE_PRETRANSFER },
+		{ CURLINFO_REDIRECT_TIME_T, PHASE_REDIRECT },
+		{ CURLINFO_SIZE_UPLOAD_T, PHASE_SIZE_UPLOAD },
+		{ CURLINFO_SIZE_DOWNLOAD_T, PHASE_SIZE_DOWNLOAD },
+		{ CURLINFO_SPEED_UPLOAD_T, PHASE_SPEED_UPLOAD },
+		{ CURLINFO_SPEED_DOWNLOAD_T, PHASE_SPEED_DOWNLOAD },
+	};
+	const char *url_str = ctx->urls[st->url_id].url_str;
+	curl_off_t val;
+	long count = 0;
+	size_t i;
+	long response_status = 0;
+	long num_connects = 0;
+	int res;
+	char *ip;
+
+	/* number of new connections made for the transfer, zero when reused */
+	res = curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &num_connects);
+
+	if (CURLE_OK == res) {
+		st->num_connects = num_connects;
+	} else {
+		fprintf(stderr, "Error geting info number of connects '%s' : %s\n", 
+				url_str, curl_easy_strerror(res));
+		return -1;
+	}
+
+	/* total time for the execution */
+	res = curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &val);
+
+	if (CURLE_OK == res) {
+		st->total_time = val;
+		/* sent right when intended, unless the caller knows better */
+		st->response_time = val;
+	}  else {
+		fprintf(stderr, "Error geting info total time '%s' : %s\n", 
+				url_str, curl_easy_strerror(res));
+
+		return -1;
+	}
+
+	/* check for name resolution time, there is none on a reused connection */ 
+	res = curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &val);
+
+	if (CURLE_OK == res) {
+		st->namelookup_time = val;
 	} else {
 		fprintf(stderr, "Error geting info name lookup time '%s' : %s\n",
-				ctx->url.url_str, curl_easy_strerror(res));
+				url_str, curl_easy_strerror(res));
 		return -1;
 	}
 
-	/* check for connect time */ 
-	res = curl_easy_getinfo(ctx->handle, CURLINFO_CONNECT_TIME_T, &val);
+	/* check for connect time, there is none on a reused connection */ 
+	res = curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &val);
 
-	if ((CURLE_OK == res) && (val>0)) {
-		ctx->st.connect_time = val;
+	if (CURLE_OK == res) {
+		st->connect_time = val;
 	} else {
 		fprintf(stderr, "Error geting info connect time '%s' : %s\n", 
-				ctx->url.url_str, curl_easy_strerror(res));
+				url_str, curl_easy_strerror(res));
 		return -1;
 	}
 
-	/* get the ip we are connected to */
-	if ((res == CURLE_OK) && 
-			!curl_easy_getinfo(ctx->handle, CURLINFO_PRIMARY_IP, &ip) 
-			&& ip) {
-		strncpy(ctx->st.server_ip,ip,15);	  
+	/* get the ip we are connected to, none when the connect has failed */
+	res = curl_easy_getinfo(handle, CURLINFO_PRIMARY_IP, &ip);
+
+	if (CURLE_OK == res) {
+		strncpy(st->server_ip, ip ? ip : "", sizeof (st->server_ip) - 1);
 	} else {
 		fprintf(stderr, "Error geting info IP '%s' : %s\n", 
-				ctx->url.url_str, curl_easy_strerror(res));
+				url_str, curl_easy_strerror(res));
 		return -1;
 	}
 
 	/* the server sent us a response code */
-	res = curl_easy_getinfo (ctx->handle, CURLINFO_RESPONSE_CODE, &response_status);
+	res = curl_easy_getinfo (handle, CURLINFO_RESPONSE_CODE, &response_status);
 
 	if (CURLE_OK == res) {
-		ctx->st.resp_code = response_status;
+		st->resp_code = response_status;
 	} else {
 		fprintf(stderr, "Error geting info response code '%s' : %s\n", 
-				ctx->url.url_str, curl_easy_strerror(res));
+				url_str, curl_easy_strerror(res));
+		return -1;
+	}
+
+	/* the names were resolved by the mode of the url */
+	st->dns_mode = ctx->urls[st->url_id].dns_mode;
+
+	/* HTTP version of the response, zero without one */
+	res = curl_easy_getinfo (handle, CURLINFO_HTTP_VERSION, &count);
+
+	if (CURLE_OK == res) {
+		st->http_version = count;
+	} else {
+		fprintf(stderr, "Error geting info HTTP version '%s' : %s\n",
+				url_str, curl_easy_strerror(res));
 		return -1;
 	}
 
 	/* Time the transfer started */
-	res = curl_easy_getinfo(ctx->handle, CURLINFO_STARTTRANSFER_TIME_T, &val);
+	res = curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &val);
 
-	if ((CURLE_OK == res) && (val>0)) {
-		ctx->st.start_transfer_time = val;
+	if (CURLE_OK == res) {
+		st->start_transfer_time = val;
 	} else {
 		fprintf(stderr, "Error geting info start transfer time '%s' : %s\n",
-				ctx->url.url_str, curl_easy_strerror(res));
+				url_str, curl_easy_strerror(res));
 		return -1;
 	}
 
-	/* always cleanup */
-	curl_easy_cleanup(ctx->handle);
+	/* The rest of the phases and the sizes, any of them may be zero */
+	for (i = 0; i < sizeof (more_phases) / sizeof (more_phases[0]); i++) {
+		res = curl_easy_getinfo(handle, more_phases[i].info, &val);
 
-	return 0; 
+		if (CURLE_OK == res) {
+			stats_phase_set (st, more_phases[i].phase, val);
+		} else {
+			fprintf(stderr, "Error geting info %s '%s' : %s\n",
+					stats_phase_key (more_phases[i].phase),
+					url_str, curl_easy_strerror(res));
+			return -1;
+		}
+	}
+
+	/* number of the redirects followed */
+	res = curl_easy_getinfo(handle, CURLINFO_REDIRECT_COUNT, &count);
+
+	if (CURLE_OK == res) {
+		st->redirect_count = count;
+	} else {
+		fprintf(stderr, "Error geting info redirect count '%s' : %s\n",
+				url_str, curl_easy_strerror(res));
+		return -1;
+	}
+
+	/* bytes of all the received headers */
+	res = curl_easy_getinfo(handle, CURLINFO_HEADER_SIZE, &count);
+
+	if (CURLE_OK == res) {
+		st->header_size = count;
+	} else {
+		fprintf(stderr, "Error geting info header size '%s' : %s\n",
+				url_str, curl_easy_strerror(res));
+		return -1;
+	}
+
+	st->curl_code = result;
+
+	return 0;
 }
 
 
 /*
 * Description - Application/url-type specific setup for a single curl handle (client)
 *
-* Input -       *ctx- pointer to client context, containing CURL handle pointer;
+* Input -       *ctx- pointer to client context;
+*               *handle - the CURL handle to setup;
 *
 * Return Code/Output - On Success - 0, on Error -1
 ****************************************************************************************/
-static int setup_handle_appl (client_context* const ctx)
+static int setup_handle_appl (client_context* const ctx, CURL* handle, url_context* url)
 {
 
-	if (!ctx) {
+	if (!ctx || !url) {
 		return -1;
 	}
 
-	/* Follow possible HTTP-redirection */
-	curl_easy_setopt (ctx->handle, CURLOPT_FOLLOWLOCATION, 1);
+	/* Setup the custom (HTTP) headers, if appropriate. The set is built
+	   once and attached by reference, setup_headers () may chain the
+	   variable headers of a try in front of it.  */
+	curl_easy_setopt (handle, CURLOPT_HTTPHEADER, url->headers.list);
+
+	/* The handle may have run a url of another method, start from GET */
+	curl_easy_setopt (handle, CURLOPT_HTTPGET, 1L);
+	curl_easy_setopt (handle, CURLOPT_CUSTOMREQUEST, NULL);
+
+	if (url->req_type == HTTP_REQ_TYPE_POST) {
+		/* The body is set per try by setup_body () */
+		curl_easy_setopt (handle, CURLOPT_POST, 1L);
+	} else if (url->req_type == HTTP_REQ_TYPE_PUT) {
+		/* The body is read from the mapped file by payload_read () */
+		curl_easy_setopt (handle, CURLOPT_UPLOAD, 1L);
+	} else if (url->req_type == HTTP_REQ_TYPE_HEAD) {
+		curl_easy_setopt (handle, CURLOPT_NOBODY, 1L);
+	} else if (url->req_type == HTTP_REQ_TYPE_DELETE) {
+		curl_easy_setopt (handle, CURLOPT_CUSTOMREQUEST, "DELETE");
+	}
 
-	/* Enable infinitive (-1) redirection number. */
-	curl_easy_setopt (ctx->handle, CURLOPT_MAXREDIRS, -1);
+	return 0;
+}
 
-	char buffer[MAX_HEADER_LEN+1];
-	int i = 0;
-	int ret = -1;
 
-    /* this while loop exists just for the demo, so that we can run in a loop 
-     * and collect the statistics 
-     *
-	 * It sends some extra header in each run we connect to the server.
-	 * it also preserves the header added from the config file, the number of 
-	 * header added is always less than the max defined header */
+/*
+ * Description - Sets the request body of a try. The bodies of the url are
+ *               taken in turn; a POST body is sent by libcurl straight from
+ *               the mapped file, a PUT body is read from it in chunks. Neither
+ *               is copied per try, whatever the number of tries in flight.
+ *               A body with placeholders is rendered into the arena instead.
+ *
+ * Input    -   *handle   - the CURL handle of the try;
+ *              *response - state of the response callbacks of the handle
+ *              *url      - the url of the try
+ *              *vars     - values of the placeholders for the try
+ * Returns  - On Success - 0, on Error -1
+ ******************************************************************************/
+static int setup_body (CURL* handle, response_ctx* response, url_context* url,
+		const tmpl_vars* vars)
+{
+	const payload* body;
+	const char* data = NULL;
+	size_t size = 0;
+
+	if (url->payloads_num) {
+		body = &url->payloads[response->bodies_sent++ % url->payloads_num];
+
+		if (!tmpl_dynamic (&body->body)) {
+			data = body->data;
+			size = body->size;
+		} else if (!(data = tmpl_render (&body->body, vars, &response->arena, &size))) {
+			return -1;
+		}
+	}
+
+	if (url->req_type == HTTP_REQ_TYPE_POST) {
+		curl_easy_setopt (handle, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t) size);
+		curl_easy_setopt (handle, CURLOPT_POSTFIELDS, data ? data : "");
+	} else if (url->req_type == HTTP_REQ_TYPE_PUT) {
+		payload_reader_begin (&response->upload, data, size);
+		curl_easy_setopt (handle, CURLOPT_INFILESIZE_LARGE, (curl_off_t) size);
+	}
+
+	return 0;
+}
+
+
+/*
+ * Description - Sets the options of a url to a handle, before a try. The
+ *               options are left as they are, when the handle is set up for
+ *               the url already; the request body and the variable headers
+ *               are set for every try.
+ *
+ * Input    -   *ctx      - pointer to client context;
+ *              *handle   - the CURL handle to setup;
+ *              *response - state of the response callbacks of the handle
+ *              *url      - the url of the try
+ *              try_id    - id of the try, unique in the worker
+ * Returns  - On Success - 0, on Error -1
+ ******************************************************************************/
+int setup_url (client_context* ctx, CURL* handle, response_ctx* response, url_context* url,
+		long try_id) {
+
+	tmpl_vars vars;
+	long version;
+
+	/* the strings of the previous try are not needed any more */
+	arena_reset (&response->arena);
 
-	while (i < ctx->current_run) {
+	vars.seq = try_id;
+	vars.worker = ctx->worker_id;
+	vars.rng = &ctx->rng;
 
-		snprintf(buffer, MAX_HEADER_LEN, "Header-name-%d: Header-value-%d", i, i);
+	/* the key is drawn for every try, whether or not the url renders it */
+	vars.key = ctx->keyspace.keys ? keyspace_pick (&ctx->keyspace, &ctx->rng) : 0;
+	response->key_rank = vars.key;
 
-		if ((ret  = header_parser(ctx, buffer)) != 0)  {
-			fprintf(stderr, "%s: Failed to add custom header \n", __func__);
+	/* Set the url, the one with placeholders is rendered for each try */
+	if (tmpl_dynamic (&url->url_tmpl)) {
+		char* url_str = tmpl_render (&url->url_tmpl, &vars, &response->arena, NULL);
+
+		if (!url_str) {
+			return -1;
+		}
+		curl_easy_setopt (handle, CURLOPT_URL, url_str);
+	} else if (response->url != url) {
+		curl_easy_setopt (handle, CURLOPT_URL, url->url_str);
+	}
+
+	if (response->url != url) {
+		/* Set the connection timeout */
+		curl_easy_setopt (handle, CURLOPT_CONNECTTIMEOUT, 
+				url->connect_timeout ? url->connect_timeout : connect_timeout);
+
+		/* Define the connection re-use policy. When passed 1, re-establish */
+		curl_easy_setopt (handle, CURLOPT_FRESH_CONNECT, url->fresh_connect);
+		curl_easy_setopt (handle, CURLOPT_FORBID_REUSE, url->fresh_connect ? 1L : 0L);
+
+		/* HTTP version of the url, or the one of the comparison pass. An
+		   HTTP/2 try waits for a connection, that it may be multiplexed
+		   on, rather than opening one more.  */
+		version = ctx->http_version ? ctx->http_version : url->http_version;
+		curl_easy_setopt (handle, CURLOPT_HTTP_VERSION, version);
+		curl_easy_setopt (handle, CURLOPT_PIPEWAIT, version >= CURL_HTTP_VERSION_2_0 ? 1L : 0L);
+
+		/* Name resolution of the url: a lookup for each new connection, a
+		   cached one or the pinned addresses. The pinned entries go to the
+		   DNS cache, the one of the run with SHARE_CACHES.  */
+		curl_easy_setopt (handle, CURLOPT_DNS_CACHE_TIMEOUT,
+				url->dns_mode == DNS_MODE_COLD ? 0L : ctx->dns_cache_ttl);
+		curl_easy_setopt (handle, CURLOPT_RESOLVE,
+				url->dns_mode == DNS_MODE_PINNED ? url->resolve : NULL);
+		curl_easy_setopt (handle, CURLOPT_IPRESOLVE, url->ip_resolve);
+
+		/* Application (url) specific setups, like HTTP-specific, FTP-specific, etc.  */
+		if (setup_handle_appl (ctx, handle, url) == -1) {
+			fprintf (stderr, "%s - error: setup_handle_appl () failed .\n", __func__);
 			return -1;
 		}
 
-		ctx->url.custom_http_hdrs_num++; i++;
+		response->url = url;
 	}
 
-	/* Setup the custom (HTTP) headers, if appropriate.  */
-	curl_easy_setopt (ctx->handle, CURLOPT_HTTPHEADER, ctx->url.custom_http_hdrs);
+	if (setup_body (handle, response, url, &vars) == -1) {
+		return -1;
+	}
 
-	//curl_easy_setopt (ctx->handle, CURLOPT_HTTPHEADER, ctx->url.custom_http_hdrs);
+	return setup_headers (ctx, handle, response, url, &vars);
+}
 
-	if (ctx->url.req_type == HTTP_REQ_TYPE_POST) {
-		/* Make POST, using post buffer, if requested.*/
-	} else if (ctx->url.req_type == HTTP_REQ_TYPE_PUT) {
 
-	} else if (ctx->url.req_type == HTTP_REQ_TYPE_HEAD) {
-		//curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, "HEAD");
-	} else if (ctx->url.req_type == HTTP_REQ_TYPE_DELETE) {
-		//curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, "DELETE");
+/*
+ * Description - Renders the variable headers of a try into the arena of the
+ *               handle and chains them in front of the fixed headers of
+ *               the url. A constant cost per try, whatever the number of the
+ *               fixed headers; nothing is done without variable headers.
+ *
+ * Input    -   *ctx      - pointer to client context;
+ *              *handle   - the CURL handle of the try;
+ *              *response - state of the response callbacks of the handle
+ *              *url      - the url of the try
+ *              *vars     - values of the placeholders for the try
+ * Returns  - On Success - 0, on Error -1
+ ******************************************************************************/
+static int setup_headers (client_context* ctx, CURL* handle, response_ctx* response,
+		url_context* url, const tmpl_vars* vars) {
+
+	char* line;
+	int i;
+
+	if (!ctx->try_id_header && !url->header_tmpls_num) {
+		return 0;
+	}
+
+	header_scratch_reset (&response->headers);
+
+	if (ctx->try_id_header) {
+		if (!(line = arena_printf (&response->arena, "%s: %d-%lld",
+						ctx->try_id_header, vars->worker, vars->seq)) ||
+				header_scratch_add (&response->headers, line) == -1) {
+			return -1;
+		}
 	}
 
+	for (i = 0; i < url->header_tmpls_num; i++) {
+		if (!(line = tmpl_render (&url->header_tmpls[i], vars, &response->arena, NULL)) ||
+				header_scratch_add (&response->headers, line) == -1) {
+			return -1;
+		}
+	}
+
+	curl_easy_setopt (handle, CURLOPT_HTTPHEADER,
+			header_scratch_chain (&response->headers, &url->headers));
+
 	return 0;
 }
 
 
 /*
- * Description - initialises client context kept CURL handle, also uses
- *               setup_handle_appl () function for the application-specific
- *               (HTTP/FTP) initialization.
+ * Description - initialises client context kept CURL handle, cloned from the
+ *               template of the worker. The handle is initialised once
+ *               and kept for all the tries of the run.
  *
  * Input    -   *ctx- pointer to client context, containing CURL handle pointer;
  * Returns  - On Success - 0, on Error -1
@@ -221,66 +714,159 @@ int setup_init (client_context* ctx) {
 		return -1;
 	}
 
-	/* init libcurl */ 
-	curl_global_init(CURL_GLOBAL_ALL);
-
-	/* init the curl session */ 
-	ctx->handle = curl_easy_init();
+	if (ctx->handle) {
+		return 0;
+	}
 
-	/* Set the url */
-	if (ctx->url.url_str) {
-		curl_easy_setopt (ctx->handle, CURLOPT_URL, ctx->url.url_str);
-	} else {
-		fprintf (stderr,"%s - error: empty url provided.\n", __func__);
+	if (!(ctx->handle = setup_handle (ctx, ctx->error_buffer, &ctx->response))) {
 		return -1;
 	}
 
-	/* disable dns caching */
-	curl_easy_setopt (ctx->handle, CURLOPT_DNS_CACHE_TIMEOUT, 0);
+	return 0;
+}
+
+
+/*
+ * Description - Releases the client context kept CURL handle together with
+ *               the connections it has cached.
+ *
+ * Input    -   *ctx- pointer to client context, containing CURL handle pointer;
+ ******************************************************************************/
+void release_init (client_context* ctx) {
+
+	if (ctx && ctx->handle) {
+		curl_easy_cleanup (ctx->handle);
+		ctx->handle = NULL;
+		validate_state_free (&ctx->response.validate);
+		arena_free (&ctx->response.arena);
+	}
+}
+
 
-	/* lets work with only ipv4 */
-	curl_easy_setopt(ctx->handle, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+/*
+ * Description - Builds the template handle of the worker: all the options
+ *               common to the tries of the run are set once, here. The
+ *               handles of the tries are cloned from it by setup_handle (),
+ *               that adds the pointers to their own state only.
+ *
+ * Input    -   *ctx- pointer to client context;
+ * Returns  - On Success - 0, on Error -1
+ ******************************************************************************/
+int setup_template (client_context* ctx) {
 
-	/* Set the connection timeout */
-	curl_easy_setopt (ctx->handle, CURLOPT_CONNECTTIMEOUT, 
-			ctx->url.connect_timeout ? ctx->url.connect_timeout : connect_timeout);
+	CURL* handle;
 
-	/* Define the connection re-use policy. When passed 1, re-establish */
-	curl_easy_setopt (ctx->handle, CURLOPT_FRESH_CONNECT, ctx->url.fresh_connect);
+	if (!ctx) {
+		return -1;
+	}
 
-	if (ctx->url.fresh_connect) {
-		curl_easy_setopt (ctx->handle, CURLOPT_FORBID_REUSE, 1);
+	if (!(handle = ctx->handle_tmpl = curl_easy_init ())) {
+		fprintf (stderr,"%s - error: curl_easy_init () failed.\n", __func__);
+		return -1;
 	}
 
-	/* enable verbose output  */
-	curl_easy_setopt (ctx->handle, CURLOPT_VERBOSE, 0);
-	curl_easy_setopt (ctx->handle, CURLOPT_DEBUGFUNCTION, debug_callback);
-	curl_easy_setopt (ctx->handle, CURLOPT_DEBUGDATA, ctx);
+	/* handles are driven by several worker threads, no signals for timeouts */
+	curl_easy_setopt (handle, CURLOPT_NOSIGNAL, 1);
 
-	/* write data */
-	curl_easy_setopt (ctx->handle, CURLOPT_WRITEFUNCTION, do_nothing_write_func);
-	//curl_easy_setopt (ctx->handle, CURLOPT_WRITEFUNCTION, writefunction);
-	//curl_easy_setopt (ctx->handle, CURLOPT_WRITEDATA, create_file(log_file));
+	/* DNS cache, TLS sessions and connections are shared by the run; the
+	   DNS mode and the address family are set per url */
+	if (ctx->share) {
+		curl_easy_setopt (handle, CURLOPT_SHARE, ctx->share);
+	}
 
-	curl_easy_setopt (ctx->handle, CURLOPT_SSL_VERIFYPEER, 0);
-	curl_easy_setopt (ctx->handle, CURLOPT_SSL_VERIFYHOST, 0);
+	/* enable verbose output  */
+	curl_easy_setopt (handle, CURLOPT_VERBOSE, 0);
+	curl_easy_setopt (handle, CURLOPT_DEBUGFUNCTION, debug_callback);
+	curl_easy_setopt (handle, CURLOPT_DEBUGDATA, ctx);
 
-	/* Set the private pointer to pass around */
-	//curl_easy_setopt (ctx->handle, CURLOPT_PRIVATE, ctx);
+	/* PUT bodies are read from the mapped files, see setup_body () */
+	curl_easy_setopt (handle, CURLOPT_READFUNCTION, payload_read);
+	curl_easy_setopt (handle, CURLOPT_SEEKFUNCTION, payload_seek);
 
-	/* Without the buffer set, we do not get any errors in tracing function. */
-	curl_easy_setopt (ctx->handle, CURLOPT_ERRORBUFFER, ctx->error_buffer);
+	/* write data; bodies are validated, then skipped unless sampled for
+	   the capture */
+	curl_easy_setopt (handle, CURLOPT_WRITEFUNCTION, response_write_func);
 
-	/* Application (url) specific setups, like HTTP-specific, FTP-specific, etc.  */
-	if (setup_handle_appl (ctx) == -1) {
-		fprintf (stderr, "%s - error: setup_curl_handle_appl () failed .\n", __func__);
-		return -1;
+	if (ctx->capture) {
+		curl_easy_setopt (handle, CURLOPT_HEADERFUNCTION, response_header_func);
 	}
 
+	curl_easy_setopt (handle, CURLOPT_SSL_VERIFYPEER, 0);
+	curl_easy_setopt (handle, CURLOPT_SSL_VERIFYHOST, 0);
+
+	/* Follow possible HTTP-redirection */
+	curl_easy_setopt (handle, CURLOPT_FOLLOWLOCATION, 1);
+
+	/* Enable infinitive (-1) redirection number. */
+	curl_easy_setopt (handle, CURLOPT_MAXREDIRS, -1);
+
+	/* The url specific options are set before each try, by setup_url () */
+
 	return 0;
 }
 
 
+/*
+ * Description - Releases the template handle of the worker
+ *
+ * Input    -   *ctx- pointer to client context;
+ ******************************************************************************/
+void release_template (client_context* ctx) {
+
+	if (ctx && ctx->handle_tmpl) {
+		curl_easy_cleanup (ctx->handle_tmpl);
+		ctx->handle_tmpl = NULL;
+	}
+}
+
+
+/*
+ * Description - Clones a CURL handle from the template of the worker and
+ *               points it at its own state; the handle may belong to the
+ *               client context or to a transfer slot of the multi loop.
+ *
+ * Input    -   *ctx          - pointer to client context;
+ *              *error_buffer - CURL_ERROR_SIZE buffer, receiving the errors
+ *              *response     - state of the response callbacks of the handle
+ * Returns  - On Success - the handle, on Error NULL
+ ******************************************************************************/
+CURL* setup_handle (client_context* ctx, char* error_buffer, response_ctx* response) {
+
+	CURL* handle;
+
+	if (!ctx || !ctx->handle_tmpl) {
+		return NULL;
+	}
+
+	if (!(handle = curl_easy_duphandle (ctx->handle_tmpl))) {
+		fprintf (stderr,"%s - error: curl_easy_duphandle () failed.\n", __func__);
+		return NULL;
+	}
+
+	/* the strings of a try are rendered into the arena of the handle */
+	if (arena_init (&response->arena, ctx->arena_size) == -1) {
+		curl_easy_cleanup (handle);
+		return NULL;
+	}
+
+	response->capture.ring = ctx->capture;
+	response->url = NULL;
+
+	curl_easy_setopt (handle, CURLOPT_READDATA, &response->upload);
+	curl_easy_setopt (handle, CURLOPT_SEEKDATA, &response->upload);
+	curl_easy_setopt (handle, CURLOPT_WRITEDATA, response);
+
+	if (ctx->capture) {
+		curl_easy_setopt (handle, CURLOPT_HEADERDATA, response);
+	}
+
+	/* Without the buffer set, we do not get any errors in tracing function. */
+	curl_easy_setopt (handle, CURLOPT_ERRORBUFFER, error_buffer);
+
+	return handle;
+}
+
+
 static void 
 dump(const char *text, FILE *stream, unsigned char *ptr, size_t size) {
 	size_t i;
@@ -360,15 +946,29 @@ writefunction( void *ptr, size_t size, size_t nmemb, void *stream) {
 */
 
 
-/* The callback to libcurl to skip all body bytes of the fetched urls. */
+/* The callback to libcurl for the body bytes of the fetched urls. */
 static size_t 
-do_nothing_write_func (void *ptr, size_t size, size_t nmemb, void *stream) {
+response_write_func (void *ptr, size_t size, size_t nmemb, void *userp) {
+
+	response_ctx *response = (response_ctx *) userp;
+
+	/* Overwriting the default behavior to write body bytes to stdout. The
+	   bytes are skipped, unless the try is sampled for the capture.  */
+	validate_update (&response->validate, ptr, size*nmemb);
+	capture_write (&response->capture, CAPTURE_BODY, ptr, size*nmemb);
+
+	return (size*nmemb);
+}
+
+
+/* The callback to libcurl for the header lines of the responses. */
+static size_t 
+response_header_func (char *ptr, size_t size, size_t nmemb, void *userp) {
+
+	response_ctx *response = (response_ctx *) userp;
 
-	(void)ptr;
-	(void)stream;
+	capture_write (&response->capture, CAPTURE_HEADER, ptr, size*nmemb);
 
-	/* Overwriting the default behavior to write body bytes to stdout and 
-	   just skipping the body bytes without any output.  */
 	return (size*nmemb);
 }
 
@@ -9,7 +9,24 @@
 #include "url.h"
 
 int get_stats_info (client_context *ctx);
+int run_serial_loop (client_context *ctx);
+int run_is_over (client_context *ctx, long issued);
+void check_error_rate (client_context *ctx);
+int run_was_aborted (void);
+long long monotonic_usec (void);
+long long monotonic_nsec (void);
 int setup_init (client_context* const ctx);
+void release_init (client_context* ctx);
+int setup_template (client_context* ctx);
+void release_template (client_context* ctx);
+CURL* setup_handle (client_context* ctx, char* error_buffer, response_ctx* response);
+int setup_url (client_context* ctx, CURL* handle, response_ctx* response, url_context* url,
+		long try_id);
+url_context* pick_url (client_context *ctx);
+void count_allocs (client_context *ctx);
+int collect_stats (client_context *ctx, CURL *handle, CURLcode result, client_stats *st);
+void report_failed_try (client_context *ctx, const char *error_buffer, CURLcode res);
+void report_transfer_error (const char *error_buffer, CURLcode res);
 
 #endif
 /* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,240 @@
+/*
+ *     selfmon.c
+ *
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <errno.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "selfmon.h"
+
+/* forward declaration */
+static int perf_open (unsigned long long config);
+static long long perf_read (int fd);
+static long long runqueue_wait (int tid);
+
+
+/*
+* Description - Inits the monitor of a worker
+*
+* Input  -      *m - the monitor
+*/
+void selfmon_init (selfmon* m)
+{
+	atomic_init (&m->lag_sum, 0);
+	atomic_init (&m->lag_num, 0);
+	atomic_init (&m->lag_max, 0);
+	atomic_init (&m->perf_cycles, -1);
+	atomic_init (&m->perf_instructions, -1);
+	atomic_init (&m->tid, 0);
+
+	m->last_cpu = 0;
+	m->last_wait = 0;
+	m->last_cycles = 0;
+	m->last_instructions = 0;
+}
+
+
+/*
+* Description - Starts the monitor in the worker thread. Opens the cycles and
+*               instructions counters of the thread, when asked for; they
+*               count the user space and the kernel, as far as
+*               perf_event_paranoid allows.
+*
+* Input  -      *m   - the monitor of the worker
+*               perf - flag; whether to open the perf counters
+* Return -      On Success - 0, -1 when perf counters are not available
+*/
+int selfmon_start (selfmon* m, int perf)
+{
+	int cycles, instructions;
+
+	atomic_store (&m->tid, (int) syscall (SYS_gettid));
+
+	if (!perf) {
+		return 0;
+	}
+
+	if ((cycles = perf_open (PERF_COUNT_HW_CPU_CYCLES)) == -1) {
+		return -1;
+	}
+
+	if ((instructions = perf_open (PERF_COUNT_HW_INSTRUCTIONS)) == -1) {
+		close (cycles);
+		return -1;
+	}
+
+	atomic_store (&m->perf_cycles, cycles);
+	atomic_store (&m->perf_instructions, instructions);
+
+	return 0;
+}
+
+
+/*
+* Description - Closes the perf counters of a worker
+*
+* Input  -      *m - the monitor
+*/
+void selfmon_close (selfmon* m)
+{
+	int fd;
+
+	if ((fd = atomic_exchange (&m->perf_cycles, -1)) != -1) {
+		close (fd);
+	}
+
+	if ((fd = atomic_exchange (&m->perf_instructions, -1)) != -1) {
+		close (fd);
+	}
+}
+
+
+/*
+* Description - Adds a lag of the event loop of the worker
+*
+* Input  -      *m  - the monitor
+*               lag - usec, the loop woke up late
+*/
+void selfmon_lag (selfmon* m, long long lag)
+{
+	atomic_fetch_add_explicit (&m->lag_sum, lag, memory_order_relaxed);
+	atomic_fetch_add_explicit (&m->lag_num, 1, memory_order_relaxed);
+
+	/* only the worker raises it, the reporter resets it */
+	if (lag > atomic_load_explicit (&m->lag_max, memory_order_relaxed)) {
+		atomic_store_explicit (&m->lag_max, lag, memory_order_relaxed);
+	}
+}
+
+
+/*
+* Description - Reads the cost of a worker since the previous read. Called by
+*               the reporter thread; the CPU time of the worker thread is
+*               read by its clock id, not by the worker.
+*
+* Input  -      *m     - the monitor of the worker
+*               thread - the worker thread, still joinable
+* Output -      *s     - the cost in the interval
+*/
+void selfmon_read (selfmon* m, pthread_t thread, selfmon_sample* s)
+{
+	struct timespec ts;
+	clockid_t clock;
+	long long value;
+	int fd;
+
+	memset (s, 0, sizeof (selfmon_sample));
+
+	if (!pthread_getcpuclockid (thread, &clock) && !clock_gettime (clock, &ts)) {
+		value = (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+		s->cpu = value - m->last_cpu;
+		m->last_cpu = value;
+	}
+
+	if ((value = runqueue_wait (atomic_load (&m->tid))) >= 0) {
+		s->wait = value - m->last_wait;
+		m->last_wait = value;
+	}
+
+	s->cycles = s->instructions = -1;
+
+	if ((fd = atomic_load (&m->perf_cycles)) != -1 && (value = perf_read (fd)) >= 0) {
+		s->cycles = value - m->last_cycles;
+		m->last_cycles = value;
+	}
+
+	if ((fd = atomic_load (&m->perf_instructions)) != -1 && (value = perf_read (fd)) >= 0) {
+		s->instructions = value - m->last_instructions;
+		m->last_instructions = value;
+	}
+
+	s->lag_sum = atomic_exchange (&m->lag_sum, 0);
+	s->lag_num = atomic_exchange (&m->lag_num, 0);
+	s->lag_max = atomic_exchange (&m->lag_max, 0);
+}
+
+
+/*
+* Description - Opens a hardware counter of the calling thread
+*
+* Input  -      config - PERF_COUNT_HW_ counter
+* Return -      On Success - the descriptor, on Error -1
+*/
+static int perf_open (unsigned long long config)
+{
+	struct perf_event_attr attr;
+	int fd;
+
+	memset (&attr, 0, sizeof (attr));
+	attr.size = sizeof (attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+
+	/* this thread, any cpu */
+	if ((fd = (int) syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0)) == -1) {
+
+		/* without the kernel, when perf_event_paranoid is 2 */
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = (int) syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+
+	return fd;
+}
+
+
+/*
+* Description - Reads a counter
+*
+* Input  -      fd - the counter
+* Return -      The value, -1 on Error
+*/
+static long long perf_read (int fd)
+{
+	long long value;
+
+	if (read (fd, &value, sizeof (value)) != sizeof (value)) {
+		return -1;
+	}
+
+	return value;
+}
+
+
+/*
+* Description - Time a thread has waited on a runqueue, from its schedstat
+*
+* Input  -      tid - kernel id of the thread, zero for none
+* Return -      usec, -1 when not known
+*/
+static long long runqueue_wait (int tid)
+{
+	unsigned long long run, wait;
+	char path[64];
+	FILE* fp;
+	int n;
+
+	if (!tid) {
+		return -1;
+	}
+
+	snprintf (path, sizeof (path), "/proc/self/task/%d/schedstat", tid);
+
+	if (!(fp = fopen (path, "r"))) {
+		return -1;
+	}
+
+	n = fscanf (fp, "%llu %llu", &run, &wait);
+	fclose (fp);
+
+	return n == 2 ? (long long) (wait / 1000) : -1;
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
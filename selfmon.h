@@ -0,0 +1,80 @@
+/*
+ *     selfmon.h
+ *
+ */
+#ifndef SELFMON_H
+#define SELFMON_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* A worker running or waiting for a cpu for this share of an interval is
+   saturated: its loop can not keep up, the latency it measures includes its
+   own queueing  */
+#define SELFMON_CPU_SATURATED 0.9
+
+/* A mean lag of the event loop above this, usec, is saturation as well */
+#define SELFMON_LAG_SATURATED_USEC 1000
+
+/* Cost of a worker, sampled by the reporter each interval. The worker
+   writes the lag and the perf descriptors, the reporter reads them.  */
+typedef struct selfmon {
+
+	/* Scheduling lag of the event loop, how late it woke up for a due
+	   timer, usec. Taken and reset by the reporter.  */
+	atomic_llong lag_sum;
+	atomic_llong lag_num;
+	atomic_llong lag_max;
+
+	/* perf counters of the worker thread, -1 when not open */
+	atomic_int perf_cycles;
+	atomic_int perf_instructions;
+
+	/* Kernel id of the worker thread, zero until it has started */
+	atomic_int tid;
+
+	/* Values at the end of the previous interval */
+	long long last_cpu;
+	long long last_wait;
+	long long last_cycles;
+	long long last_instructions;
+
+} selfmon;
+
+/* Cost of a worker in an interval */
+typedef struct selfmon_sample {
+
+	/* CPU time of the worker thread, usec */
+	long long cpu;
+
+	/* Time the thread was ready to run, but waited for a cpu, usec */
+	long long wait;
+
+	/* Cycles and instructions of the thread, -1 without perf counters */
+	long long cycles;
+	long long instructions;
+
+	/* Lag of the event loop: wake-ups, their sum and maximum, usec */
+	long long lag_num;
+	long long lag_sum;
+	long long lag_max;
+
+} selfmon_sample;
+
+/* Inits the monitor of a worker, before the thread is started */
+void selfmon_init (selfmon* m);
+
+/* Starts the monitor in the worker thread, with perf counters on request */
+int selfmon_start (selfmon* m, int perf);
+
+/* Closes the perf counters */
+void selfmon_close (selfmon* m);
+
+/* Adds a lag of the event loop, called by the worker */
+void selfmon_lag (selfmon* m, long long lag);
+
+/* Reads the cost of the worker <thread> since the previous read */
+void selfmon_read (selfmon* m, pthread_t thread, selfmon_sample* s);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,927 @@
+/*
+ *     server.c
+ *
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "server.h"
+#include "alias.h"
+#include "rng.h"
+
+/* Most bytes of a request head */
+#define SERVE_HEAD_MAX 8192
+
+/* Events taken by one epoll_wait () */
+#define SERVE_EVENTS_NUM 256
+
+/* Longest wait for the events, msec; the stop flag is checked as often */
+#define SERVE_POLL_MSEC 100
+
+/* A prebuilt response head of a status */
+typedef struct serve_response {
+	int status;
+	char head[160];
+	size_t head_len;
+	/* Size of the body, zero for 1xx, 204 and 304 */
+	size_t body_len;
+} serve_response;
+
+/* A client connection */
+typedef struct serve_conn {
+
+	/* The socket, -1 once closed */
+	int fd;
+
+	/* Received bytes, not processed yet */
+	char in[SERVE_HEAD_MAX];
+	size_t in_len;
+
+	/* Bytes of the request body still to skip */
+	long long body_left;
+
+	/* The response being sent, NULL for none */
+	const serve_response* resp;
+	size_t sent;
+	int no_body;
+
+	/* Flag; the connection is closed, once the response is sent */
+	int close_after;
+
+	/* Flag; the response waits for its delay on the timer heap */
+	int pending;
+
+	/* Events watched by epoll */
+	unsigned int events;
+
+} serve_conn;
+
+/* A response due at <due>, usec of the monotonic clock */
+typedef struct serve_timer {
+	long long due;
+	serve_conn* conn;
+} serve_timer;
+
+/* An epoll thread of the server */
+typedef struct serve_thread {
+
+	const serve_conf* conf;
+
+	pthread_t thread;
+	int listen_fd;
+	int epoll_fd;
+	rng_state rng;
+
+	/* Min-heap of the delayed responses */
+	serve_timer* timers;
+	int timers_num;
+	int timers_size;
+
+	long long requests;
+	long long connections;
+
+	/* Result of the thread, 0 on success */
+	int ret;
+
+} serve_thread;
+
+/* Shared read-only by the threads, built by serve_run () */
+static serve_response responses[SERVE_STATUS_MAX];
+static alias_table status_picker;
+static char* body;
+
+/* Set by SIGINT and SIGTERM */
+static volatile sig_atomic_t serve_stop;
+
+/* forward declaration */
+static void* serve_thread_run (void* arg);
+static int serve_listen (int port);
+static void serve_accept (serve_thread* t);
+static void serve_input (serve_thread* t, serve_conn* c);
+static void serve_process (serve_thread* t, serve_conn* c);
+static int serve_parse_head (serve_conn* c, size_t head_len);
+static long long serve_length (const char* value, size_t len);
+static int serve_has_token (const char* value, size_t len, const char* token);
+static int serve_write (serve_thread* t, serve_conn* c);
+static void serve_close (serve_conn* c);
+static void serve_watch (serve_thread* t, serve_conn* c, unsigned int events);
+static long serve_delay (serve_thread* t);
+static int timer_push (serve_thread* t, long long due, serve_conn* c);
+static void timers_fire (serve_thread* t);
+static long long now_usec (void);
+static const char* reason_phrase (int status);
+static void on_stop (int sig);
+
+
+/*
+* Description - Parses the delay distribution of the responses
+*
+* Input  -      *conf  - the server params
+*               *value - none, const:<usec>, uniform:<low>-<high> or exp:<mean>
+* Return -      On Success - 0, on Error -1
+*/
+int serve_parse_delay (serve_conf* conf, const char* value)
+{
+	long low = 0, high = 0;
+	int n = 0;
+
+	if (!strcmp (value, "none")) {
+		conf->delay = SERVE_DELAY_NONE;
+	} else if (sscanf (value, "const:%ld%n", &low, &n) == 1 && !value[n] && low >= 0) {
+		conf->delay = SERVE_DELAY_CONST;
+	} else if (sscanf (value, "uniform:%ld-%ld%n", &low, &high, &n) == 2 && !value[n] &&
+			low >= 0 && low <= high) {
+		conf->delay = SERVE_DELAY_UNIFORM;
+	} else if (sscanf (value, "exp:%ld%n", &low, &n) == 1 && !value[n] && low > 0) {
+		conf->delay = SERVE_DELAY_EXP;
+	} else {
+		fprintf (stderr, "%s - error: delay \"%s\" is not one of none, const:<usec>, "
+				"uniform:<low>-<high> or exp:<mean>.\n", __func__, value);
+		return -1;
+	}
+
+	conf->delay_low = low;
+	conf->delay_high = high;
+
+	return 0;
+}
+
+
+/*
+* Description - Parses the status mix of the responses
+*
+* Input  -      *conf  - the server params
+*               *value - <status>:<weight> pairs, separated by commas
+* Return -      On Success - 0, on Error -1
+*/
+int serve_parse_status (serve_conf* conf, const char* value)
+{
+	const char* p = value;
+	double weight;
+	int status;
+	int n = 0;
+
+	conf->statuses_num = 0;
+
+	while (*p) {
+		if (conf->statuses_num == SERVE_STATUS_MAX ||
+				sscanf (p, "%d:%lf%n", &status, &weight, &n) != 2 ||
+				status < 100 || status > 599 || weight < 0 ||
+				(p[n] && p[n] != ',')) {
+			fprintf (stderr, "%s - error: status mix \"%s\" is not up to %d of "
+					"<status>:<weight>, e.g. 200:99,503:1.\n",
+					__func__, value, SERVE_STATUS_MAX);
+			return -1;
+		}
+
+		conf->statuses[conf->statuses_num] = status;
+		conf->status_weights[conf->statuses_num++] = weight;
+
+		p += n;
+		if (*p == ',') {
+			p++;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Runs the loopback HTTP/1.1 server. Each thread has its own
+*               listening socket on the port (SO_REUSEPORT) and epoll
+*               loop, the kernel spreads the connections among them. The
+*               requests are answered with a body of the given size, after
+*               the delay of the distribution and with a status of the mix.
+*
+* Input  -      *conf - the server params
+* Return -      On Success - 0, on Error -1
+*/
+int serve_run (serve_conf* conf)
+{
+	serve_thread* threads;
+	struct sigaction sa;
+	long long requests = 0, connections = 0;
+	int ret = 0;
+	int i;
+
+	if (conf->threads <= 0) {
+		conf->threads = 1;
+	}
+
+	if (!conf->statuses_num) {
+		conf->statuses[0] = 200;
+		conf->status_weights[0] = 1;
+		conf->statuses_num = 1;
+	}
+
+	for (i = 0; i < conf->statuses_num; i++) {
+		int status = conf->statuses[i];
+
+		responses[i].status = status;
+		responses[i].body_len = (status < 200 || status == 204 || status == 304) ?
+			0 : conf->body_size;
+		responses[i].head_len = (size_t) snprintf (responses[i].head,
+				sizeof (responses[i].head),
+				"HTTP/1.1 %d %s\r\nContent-Length: %zu\r\n"
+				"Content-Type: application/octet-stream\r\n\r\n",
+				status, reason_phrase (status), responses[i].body_len);
+	}
+
+	if (alias_init (&status_picker, conf->status_weights, conf->statuses_num) == -1) {
+		return -1;
+	}
+
+	if (!(body = (char *) malloc (conf->body_size + 1))) {
+		fprintf (stderr, "%s - error: allocation of %zu bytes failed.\n",
+				__func__, conf->body_size);
+		alias_free (&status_picker);
+		return -1;
+	}
+	memset (body, 'x', conf->body_size);
+
+	if (!(threads = (serve_thread *) calloc (conf->threads, sizeof (serve_thread)))) {
+		fprintf (stderr, "%s - error: allocation failed.\n", __func__);
+		free (body);
+		alias_free (&status_picker);
+		return -1;
+	}
+
+	memset (&sa, 0, sizeof (sa));
+	sa.sa_handler = on_stop;
+	sigaction (SIGINT, &sa, NULL);
+	sigaction (SIGTERM, &sa, NULL);
+	signal (SIGPIPE, SIG_IGN);
+
+	for (i = 0; i < conf->threads; i++) {
+		serve_thread* t = &threads[i];
+
+		t->conf = conf;
+		rng_seed (&t->rng, (uint64_t) i + 1);
+
+		if ((t->listen_fd = serve_listen (conf->port)) == -1 ||
+				pthread_create (&t->thread, NULL, serve_thread_run, t)) {
+			fprintf (stderr, "%s - error: start of server thread %d failed.\n",
+					__func__, i);
+			if (t->listen_fd != -1) {
+				close (t->listen_fd);
+			}
+			serve_stop = 1;
+			conf->threads = i;
+			ret = -1;
+			break;
+		}
+	}
+
+	if (!ret) {
+		printf ("Serving on 127.0.0.1:%d with %d threads, %zu bytes bodies;\n",
+				conf->port, conf->threads, conf->body_size);
+		fflush (stdout);
+	}
+
+	for (i = 0; i < conf->threads; i++) {
+		pthread_join (threads[i].thread, NULL);
+		close (threads[i].listen_fd);
+
+		requests += threads[i].requests;
+		connections += threads[i].connections;
+		if (threads[i].ret) {
+			ret = -1;
+		}
+	}
+
+	printf ("Served %lld requests on %lld connections;\n", requests, connections);
+
+	free (threads);
+	free (body);
+	alias_free (&status_picker);
+
+	return ret;
+}
+
+
+/*
+* Description - Event loop of a server thread
+*
+* Input  -      *arg - the thread
+* Return -      NULL
+*/
+static void* serve_thread_run (void* arg)
+{
+	serve_thread* t = (serve_thread *) arg;
+	struct epoll_event events[SERVE_EVENTS_NUM];
+	struct epoll_event ev;
+	int n, i;
+
+	if ((t->epoll_fd = epoll_create1 (0)) == -1) {
+		fprintf (stderr, "%s - error: epoll_create1 () failed, errno %d.\n",
+				__func__, errno);
+		t->ret = -1;
+		return NULL;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	epoll_ctl (t->epoll_fd, EPOLL_CTL_ADD, t->listen_fd, &ev);
+
+	while (!serve_stop) {
+		int timeout = SERVE_POLL_MSEC;
+
+		/* wake up for the first delayed response */
+		if (t->timers_num) {
+			long long wait = (t->timers[0].due - now_usec () + 999) / 1000;
+
+			timeout = wait < 0 ? 0 : (wait < timeout ? (int) wait : timeout);
+		}
+
+		if ((n = epoll_wait (t->epoll_fd, events, SERVE_EVENTS_NUM, timeout)) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf (stderr, "%s - error: epoll_wait () failed, errno %d.\n",
+					__func__, errno);
+			t->ret = -1;
+			break;
+		}
+
+		for (i = 0; i < n; i++) {
+			serve_conn* c = (serve_conn *) events[i].data.ptr;
+
+			if (!c) {
+				serve_accept (t);
+			} else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+				serve_close (c);
+			} else if (events[i].events & EPOLLOUT) {
+				if (serve_write (t, c) == 0) {
+					serve_process (t, c);
+				}
+			} else if (events[i].events & EPOLLIN) {
+				serve_input (t, c);
+			}
+		}
+
+		timers_fire (t);
+	}
+
+	/* the connections are left to the exit of the process */
+	free (t->timers);
+	close (t->epoll_fd);
+
+	return NULL;
+}
+
+
+/*
+* Description - Opens a non-blocking listening socket on 127.0.0.1
+*
+* Input  -      port - the port
+* Return -      On Success - the socket, on Error -1
+*/
+static int serve_listen (int port)
+{
+	struct sockaddr_in addr;
+	int on = 1;
+	int fd;
+
+	if ((fd = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1) {
+		fprintf (stderr, "%s - error: socket () failed, errno %d.\n", __func__, errno);
+		return -1;
+	}
+
+	setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on));
+	setsockopt (fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof (on));
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons ((unsigned short) port);
+	addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+	if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) == -1 ||
+			listen (fd, SOMAXCONN) == -1) {
+		fprintf (stderr, "%s - error: bind () or listen () on port %d failed, errno %d.\n",
+				__func__, port, errno);
+		close (fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+
+/*
+* Description - Accepts the pending connections of the listening socket
+*
+* Input  -      *t - the thread
+*/
+static void serve_accept (serve_thread* t)
+{
+	struct epoll_event ev;
+	serve_conn* c;
+	int on = 1;
+	int fd;
+
+	while ((fd = accept4 (t->listen_fd, NULL, NULL, SOCK_NONBLOCK)) != -1) {
+
+		if (!(c = (serve_conn *) malloc (sizeof (serve_conn)))) {
+			close (fd);
+			continue;
+		}
+		c->fd = fd;
+		c->in_len = 0;
+		c->body_left = 0;
+		c->resp = NULL;
+		c->sent = 0;
+		c->no_body = c->close_after = c->pending = 0;
+		c->events = EPOLLIN;
+
+		setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on));
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = c;
+
+		if (epoll_ctl (t->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+			close (fd);
+			free (c);
+			continue;
+		}
+
+		t->connections++;
+	}
+}
+
+
+/*
+* Description - Reads what the client has sent and answers the complete
+*               requests
+*
+* Input  -      *t - the thread
+*               *c - the connection
+*/
+static void serve_input (serve_thread* t, serve_conn* c)
+{
+	ssize_t n;
+
+	while (c->in_len < sizeof (c->in)) {
+		n = read (c->fd, c->in + c->in_len, sizeof (c->in) - c->in_len);
+
+		if (n > 0) {
+			c->in_len += (size_t) n;
+		} else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+			serve_close (c);
+			return;
+		} else if (errno == EAGAIN) {
+			break;
+		}
+	}
+
+	serve_process (t, c);
+}
+
+
+/*
+* Description - Answers the complete requests in the input of a connection,
+*               in their order. Stops at a delayed response or a blocked
+*               write, the rest waits for them.
+*
+* Input  -      *t - the thread
+*               *c - the connection
+*/
+static void serve_process (serve_thread* t, serve_conn* c)
+{
+	while (c->fd != -1 && !c->pending && !c->resp) {
+		size_t used = 0;
+		char* end;
+		long delay;
+
+		if (c->body_left) {
+			used = c->body_left < (long long) c->in_len ? (size_t) c->body_left : c->in_len;
+			c->body_left -= (long long) used;
+		} else if ((end = (char *) memmem (c->in, c->in_len, "\r\n\r\n", 4))) {
+			used = (size_t) (end - c->in) + 4;
+
+			if (serve_parse_head (c, used) == -1) {
+				serve_close (c);
+				return;
+			}
+
+			t->requests++;
+			c->resp = &responses[alias_pick (&status_picker, &t->rng)];
+			c->sent = 0;
+		} else if (c->in_len == sizeof (c->in)) {
+			/* the head does not fit */
+			serve_close (c);
+			return;
+		}
+
+		if (!used) {
+			break;
+		}
+
+		memmove (c->in, c->in + used, c->in_len - used);
+		c->in_len -= used;
+
+		if (!c->resp) {
+			continue;
+		}
+
+		if ((delay = serve_delay (t)) > 0) {
+			if (timer_push (t, now_usec () + delay, c) == -1) {
+				serve_close (c);
+				return;
+			}
+			c->pending = 1;
+			serve_watch (t, c, 0);
+			return;
+		}
+
+		if (serve_write (t, c) != 0) {
+			return;
+		}
+	}
+}
+
+
+/*
+* Description - Reads the headers of a request, that matter for the framing
+*               of the next one and for the response
+*
+* Input  -      *c       - the connection, with the head at its input
+*               head_len - length of the head, with the empty line
+* Return -      On Success - 0, -1 for a request, that is not supported
+*/
+static int serve_parse_head (serve_conn* c, size_t head_len)
+{
+	char* line = c->in;
+	char* head_end = c->in + head_len;
+	size_t line_len;
+
+	c->no_body = !strncmp (c->in, "HEAD ", 5);
+	c->close_after = !!memmem (c->in, head_len, " HTTP/1.0\r\n", 11);
+
+	while ((line = (char *) memmem (line, (size_t) (head_end - line), "\r\n", 2)) &&
+			line + 2 < head_end) {
+		line += 2;
+
+		/* the head ends with an empty line, every line has its end; the
+		   input past it is the next pipelined request */
+		line_len = (size_t) ((char *) memmem (line, (size_t) (head_end - line),
+					"\r\n", 2) - line);
+
+		if (line_len >= 15 && !strncasecmp (line, "Content-Length:", 15)) {
+			if ((c->body_left = serve_length (line + 15, line_len - 15)) < 0) {
+				return -1;
+			}
+		} else if (line_len >= 18 && !strncasecmp (line, "Transfer-Encoding:", 18)) {
+			/* chunked bodies are not supported */
+			return -1;
+		} else if (line_len >= 11 && !strncasecmp (line, "Connection:", 11)) {
+			c->close_after = serve_has_token (line + 11, line_len - 11, "close");
+		} else if (line_len >= 7 && !strncasecmp (line, "Expect:", 7) &&
+				write (c->fd, "HTTP/1.1 100 Continue\r\n\r\n", 25) != 25) {
+			return -1;
+		}
+	}
+
+	return c->body_left < 0 ? -1 : 0;
+}
+
+
+/*
+* Description - Parses the value of a Content-Length header, not terminated
+*
+* Input  -      *value - the value, after the colon
+*               len    - its length, up to the end of the line
+* Return -      The length, -1 when it is not a valid one
+*/
+static long long serve_length (const char* value, size_t len)
+{
+	long long length = 0;
+	size_t i = 0;
+	int digits = 0;
+
+	while (i < len && (value[i] == ' ' || value[i] == '\t')) {
+		i++;
+	}
+
+	for (; i < len && value[i] >= '0' && value[i] <= '9'; i++, digits++) {
+		if (length > (LLONG_MAX - 9) / 10) {
+			return -1;
+		}
+		length = length * 10 + (value[i] - '0');
+	}
+
+	while (i < len && (value[i] == ' ' || value[i] == '\t')) {
+		i++;
+	}
+
+	return digits && i == len ? length : -1;
+}
+
+
+/*
+* Description - Looks for a token in the comma separated list of a header
+*               value, not terminated, case insensitive
+*
+* Input  -      *value - the value, after the colon
+*               len    - its length, up to the end of the line
+*               *token - the token
+* Return -      1 when the value has the token, 0 otherwise
+*/
+static int serve_has_token (const char* value, size_t len, const char* token)
+{
+	size_t token_len = strlen (token);
+	size_t start = 0, end;
+
+	while (start < len) {
+		end = start;
+		while (end < len && value[end] != ',') {
+			end++;
+		}
+
+		/* the token of the element, without the spaces around it */
+		while (start < end && (value[start] == ' ' || value[start] == '\t')) {
+			start++;
+		}
+		while (end > start && (value[end - 1] == ' ' || value[end - 1] == '\t')) {
+			end--;
+		}
+
+		if (end - start == token_len && !strncasecmp (value + start, token, token_len)) {
+			return 1;
+		}
+
+		while (end < len && value[end] != ',') {
+			end++;
+		}
+		start = end + 1;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Writes the rest of the response. Watches for the socket to
+*               get writable, when it blocks.
+*
+* Input  -      *t - the thread
+*               *c - the connection
+* Return -      0 when the response is sent, 1 when the write blocks,
+*               -1 when the connection is closed and released
+*/
+static int serve_write (serve_thread* t, serve_conn* c)
+{
+	size_t body_len;
+	size_t total;
+	ssize_t n;
+
+	if (!c->resp) {
+		return 0;
+	}
+
+	body_len = c->no_body ? 0 : c->resp->body_len;
+	total = c->resp->head_len + body_len;
+
+	while (c->sent < total) {
+		struct iovec iov[2];
+		int iov_num = 0;
+
+		if (c->sent < c->resp->head_len) {
+			iov[iov_num].iov_base = (void *) (c->resp->head + c->sent);
+			iov[iov_num++].iov_len = c->resp->head_len - c->sent;
+		}
+		if (body_len) {
+			size_t from = c->sent > c->resp->head_len ? c->sent - c->resp->head_len : 0;
+
+			iov[iov_num].iov_base = body + from;
+			iov[iov_num++].iov_len = body_len - from;
+		}
+
+		if ((n = writev (c->fd, iov, iov_num)) > 0) {
+			c->sent += (size_t) n;
+		} else if (n == -1 && errno == EAGAIN) {
+			serve_watch (t, c, EPOLLOUT);
+			return 1;
+		} else if (n == -1 && errno == EINTR) {
+			continue;
+		} else {
+			serve_close (c);
+			return -1;
+		}
+	}
+
+	c->resp = NULL;
+
+	if (c->close_after) {
+		serve_close (c);
+		return -1;
+	}
+
+	serve_watch (t, c, EPOLLIN);
+
+	return 0;
+}
+
+
+/*
+* Description - Closes a connection. A connection with a delayed response
+*               is released, when the response is due.
+*
+* Input  -      *c - the connection
+*/
+static void serve_close (serve_conn* c)
+{
+	if (c->fd != -1) {
+		close (c->fd);
+		c->fd = -1;
+	}
+
+	if (!c->pending) {
+		free (c);
+	}
+}
+
+
+/*
+* Description - Sets the events to watch on a connection
+*
+* Input  -      *t     - the thread
+*               *c     - the connection
+*               events - EPOLLIN, EPOLLOUT or none
+*/
+static void serve_watch (serve_thread* t, serve_conn* c, unsigned int events)
+{
+	struct epoll_event ev;
+
+	/* one syscall less per request, the usual case */
+	if (c->events == events) {
+		return;
+	}
+
+	c->events = events;
+	ev.events = events;
+	ev.data.ptr = c;
+	epoll_ctl (t->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+
+/*
+* Description - Draws the delay of a response
+*
+* Input  -      *t - the thread
+* Return -      The delay, usec
+*/
+static long serve_delay (serve_thread* t)
+{
+	const serve_conf* conf = t->conf;
+
+	switch (conf->delay) {
+	case SERVE_DELAY_CONST:
+		return conf->delay_low;
+	case SERVE_DELAY_UNIFORM:
+		return (long) rng_range (&t->rng, (uint64_t) conf->delay_low,
+				(uint64_t) conf->delay_high);
+	case SERVE_DELAY_EXP:
+		return (long) (-log (1.0 - rng_double (&t->rng)) * (double) conf->delay_low);
+	default:
+		return 0;
+	}
+}
+
+
+/*
+* Description - Adds a delayed response to the timer heap
+*
+* Input  -      *t  - the thread
+*               due - when the response is due, usec
+*               *c  - the connection
+* Return -      On Success - 0, on Error -1
+*/
+static int timer_push (serve_thread* t, long long due, serve_conn* c)
+{
+	int i;
+
+	if (t->timers_num == t->timers_size) {
+		int size = t->timers_size ? t->timers_size * 2 : 256;
+		serve_timer* timers = (serve_timer *) realloc (t->timers, size * sizeof (serve_timer));
+
+		if (!timers) {
+			fprintf (stderr, "%s - error: allocation of %d timers failed.\n", __func__, size);
+			return -1;
+		}
+		t->timers = timers;
+		t->timers_size = size;
+	}
+
+	for (i = t->timers_num++; i > 0 && t->timers[(i - 1) / 2].due > due; i = (i - 1) / 2) {
+		t->timers[i] = t->timers[(i - 1) / 2];
+	}
+	t->timers[i].due = due;
+	t->timers[i].conn = c;
+
+	return 0;
+}
+
+
+/*
+* Description - Sends the responses, that are due
+*
+* Input  -      *t - the thread
+*/
+static void timers_fire (serve_thread* t)
+{
+	long long now = now_usec ();
+
+	while (t->timers_num && t->timers[0].due <= now) {
+		serve_conn* c = t->timers[0].conn;
+		serve_timer last = t->timers[--t->timers_num];
+		int i = 0, child;
+
+		/* sift the last one down from the root */
+		while ((child = 2 * i + 1) < t->timers_num) {
+			if (child + 1 < t->timers_num && t->timers[child + 1].due < t->timers[child].due) {
+				child++;
+			}
+			if (last.due <= t->timers[child].due) {
+				break;
+			}
+			t->timers[i] = t->timers[child];
+			i = child;
+		}
+		if (t->timers_num) {
+			t->timers[i] = last;
+		}
+
+		c->pending = 0;
+
+		if (c->fd == -1) {
+			free (c);
+			continue;
+		}
+
+		if (serve_write (t, c) == 0) {
+			serve_process (t, c);
+		}
+	}
+}
+
+
+/* Monotonic clock, usec */
+static long long now_usec (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/* Reason phrase of a status */
+static const char* reason_phrase (int status)
+{
+	switch (status) {
+	case 200: return "OK";
+	case 201: return "Created";
+	case 204: return "No Content";
+	case 301: return "Moved Permanently";
+	case 302: return "Found";
+	case 304: return "Not Modified";
+	case 400: return "Bad Request";
+	case 403: return "Forbidden";
+	case 404: return "Not Found";
+	case 429: return "Too Many Requests";
+	case 500: return "Internal Server Error";
+	case 502: return "Bad Gateway";
+	case 503: return "Service Unavailable";
+	case 504: return "Gateway Timeout";
+	default:  return "Status";
+	}
+}
+
+
+/* Handler of SIGINT and SIGTERM */
+static void on_stop (int sig)
+{
+	(void) sig;
+	serve_stop = 1;
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
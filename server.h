@@ -0,0 +1,55 @@
+/*
+ *     server.h
+ *
+ */
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+
+/* Most status codes of a status mix */
+#define SERVE_STATUS_MAX 16
+
+/* Distributions of the delay of a response */
+typedef enum serve_delay_type {
+	SERVE_DELAY_NONE = 0,   /* answered right away */
+	SERVE_DELAY_CONST,      /* const:<usec> */
+	SERVE_DELAY_UNIFORM,    /* uniform:<low>-<high>, usec */
+	SERVE_DELAY_EXP,        /* exp:<mean>, usec */
+} serve_delay_type;
+
+/* Params of the built-in loopback server, given by the command line */
+typedef struct serve_conf {
+
+	/* Port to listen on, zero when not serving */
+	int port;
+
+	/* Number of the epoll threads, each with its own listening socket */
+	int threads;
+
+	/* Size of the response bodies */
+	size_t body_size;
+
+	/* Delay of the responses; const takes delay_low, exp its mean from it */
+	serve_delay_type delay;
+	long delay_low;
+	long delay_high;
+
+	/* Status codes of the responses and their weights, 200 when none */
+	int statuses[SERVE_STATUS_MAX];
+	double status_weights[SERVE_STATUS_MAX];
+	int statuses_num;
+
+} serve_conf;
+
+/* Parses the delay distribution, e.g. "exp:500" */
+int serve_parse_delay (serve_conf* conf, const char* value);
+
+/* Parses the status mix, e.g. "200:99,503:1" */
+int serve_parse_status (serve_conf* conf, const char* value);
+
+/* Serves on 127.0.0.1, until SIGINT or SIGTERM */
+int serve_run (serve_conf* conf);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,137 @@
+/*
+ *     share.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <curl/curl.h>
+
+#include "share.h"
+
+/* forward declaration */
+static void
+lock_callback (CURL* handle, curl_lock_data data, curl_lock_access access, void* userp);
+static void
+unlock_callback (CURL* handle, curl_lock_data data, void* userp);
+
+
+/*
+* Description - Creates the share handle, that shares the DNS cache and TLS
+*               session ids, and optionally the connection pool, among all
+*               the handles of a run.
+*
+* Input  -      *sh                - the share context to init
+*               share_connections  - when true, the connection pool is shared
+* Return -      On Success - 0, on Error -1
+*/
+int share_init (share_context* sh, int share_connections)
+{
+	int i;
+
+	if (!sh) {
+		return -1;
+	}
+
+	memset (sh, 0, sizeof (share_context));
+
+	for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+		pthread_rwlock_init (&sh->locks[i], NULL);
+	}
+
+	if (!(sh->share = curl_share_init ())) {
+		fprintf (stderr, "%s - error: curl_share_init () failed.\n", __func__);
+		return -1;
+	}
+
+	curl_share_setopt (sh->share, CURLSHOPT_LOCKFUNC, lock_callback);
+	curl_share_setopt (sh->share, CURLSHOPT_UNLOCKFUNC, unlock_callback);
+	curl_share_setopt (sh->share, CURLSHOPT_USERDATA, sh);
+
+	if (curl_share_setopt (sh->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS) != CURLSHE_OK) {
+		fprintf (stderr, "%s - error: failed to share DNS cache.\n", __func__);
+		return -1;
+	}
+
+	/* Not each TLS backend supports it, the run goes on without */
+	if (curl_share_setopt (sh->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION) != CURLSHE_OK) {
+		fprintf (stderr, "%s - warning: failed to share TLS sessions.\n", __func__);
+	}
+
+	if (share_connections) {
+		if (curl_share_setopt (sh->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT) != CURLSHE_OK) {
+			fprintf (stderr, "%s - warning: failed to share connections.\n", __func__);
+		} else {
+			sh->share_connections = 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Releases the share handle and the locks
+*
+* Input  -      *sh - the share context
+*/
+void share_cleanup (share_context* sh)
+{
+	int i;
+
+	if (!sh) {
+		return;
+	}
+
+	if (sh->share && curl_share_cleanup (sh->share) != CURLSHE_OK) {
+		fprintf (stderr, "%s - error: share is still in use.\n", __func__);
+		return;
+	}
+
+	sh->share = NULL;
+
+	for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+		pthread_rwlock_destroy (&sh->locks[i]);
+	}
+}
+
+
+/*
+* Description - libcurl lock callback. Takes the lock of the data type, shared
+*               access takes it for reading.
+*
+* Input  -      data   - the type of the data to lock
+*               access - CURL_LOCK_ACCESS_SHARED or CURL_LOCK_ACCESS_SINGLE
+*               *userp - the share context
+*/
+static void
+lock_callback (CURL* handle, curl_lock_data data, curl_lock_access access, void* userp)
+{
+	share_context* sh = (share_context *) userp;
+	(void)handle;
+
+	if (access == CURL_LOCK_ACCESS_SHARED) {
+		pthread_rwlock_rdlock (&sh->locks[data]);
+	} else {
+		pthread_rwlock_wrlock (&sh->locks[data]);
+	}
+}
+
+
+/*
+* Description - libcurl unlock callback. Releases the lock of the data type.
+*
+* Input  -      data   - the type of the data to unlock
+*               *userp - the share context
+*/
+static void
+unlock_callback (CURL* handle, curl_lock_data data, void* userp)
+{
+	share_context* sh = (share_context *) userp;
+	(void)handle;
+
+	pthread_rwlock_unlock (&sh->locks[data]);
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
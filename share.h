@@ -0,0 +1,36 @@
+/*
+ *     share.h
+ *
+ */
+#ifndef SHARE_H
+#define SHARE_H
+
+#include <pthread.h>
+#include <curl/curl.h>
+
+/* Default DNS_CACHE_TTL in seconds, of the names of the cached DNS mode */
+#define SHARE_DNS_CACHE_TIMEOUT 60
+
+/* Caches shared by all the handles of a run */
+typedef struct share_context {
+
+	/* libcurl share handle, attached to the handles with CURLOPT_SHARE */
+	CURLSH* share;
+
+	/* Lock per shared data type. Shared access takes the read side, so
+	   that lookups of several threads do not serialize on each other.  */
+	pthread_rwlock_t locks[CURL_LOCK_DATA_LAST];
+
+	/* Flag; whether the connection pool is shared as well */
+	int share_connections;
+
+} share_context;
+
+/* Creates the share handle with DNS, TLS session and, optionally, connections */
+int share_init (share_context* sh, int share_connections);
+
+/* Releases the share handle, all the handles using it are to be cleaned up before */
+void share_cleanup (share_context* sh);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,859 @@
+/*
+ *     stats.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <sched.h>
+
+#include "conf.h"
+#include "hist.h"
+#include "stats.h"
+
+/* Description of a phase: names, unit and place in the results of a try */
+typedef struct phase_info {
+	const char* name;
+	const char* key;
+	stat_unit unit;
+	size_t offset;
+} phase_info;
+
+#define PHASE(name, key, unit, field) { name, key, unit, offsetof (client_stats, field) }
+
+/* The phases, in the order of stat_phase, as printed in the reports */
+static const phase_info phases [PHASE_NUM] = {
+	PHASE ("Total time", "total_time", UNIT_USEC, total_time),
+	PHASE ("Name lookup time", "namelookup_time", UNIT_USEC, namelookup_time),
+	PHASE ("Connect time", "connect_time", UNIT_USEC, connect_time),
+	PHASE ("TLS time", "appconnect_time", UNIT_USEC, appconnect_time),
+	PHASE ("Pretransfer time", "pretransfer_time", UNIT_USEC, pretransfer_time),
+	PHASE ("Start time", "start_transfer_time", UNIT_USEC, start_transfer_time),
+	PHASE ("Redirect time", "redirect_time", UNIT_USEC, redirect_time),
+	PHASE ("Response time", "response_time", UNIT_USEC, response_time),
+	PHASE ("Redirects", "redirect_count", UNIT_COUNT, redirect_count),
+	PHASE ("Upload size", "size_upload", UNIT_BYTES, size_upload),
+	PHASE ("Download size", "size_download", UNIT_BYTES, size_download),
+	PHASE ("Upload speed", "speed_upload", UNIT_BYTES_PER_SEC, speed_upload),
+	PHASE ("Download speed", "speed_download", UNIT_BYTES_PER_SEC, speed_download),
+	PHASE ("Header size", "header_size", UNIT_BYTES, header_size),
+	PHASE ("Handle setup time", "setup_time", UNIT_NSEC, setup_time),
+};
+
+/* Suffixes of the units in the reports */
+static const char* unit_suffixes [] = { "secs", "", "bytes", "bytes/sec", "usec" };
+
+/* Percentiles printed for each timing phase */
+static const double report_percentiles [] = { 50.0, 90.0, 99.0, 99.9 };
+
+#define REPORT_PERCENTILES_NUM \
+	(sizeof (report_percentiles) / sizeof (report_percentiles[0]))
+
+/* Initial number of the kept samples, doubled when exhausted */
+#define SAMPLES_INITIAL_SIZE 1024
+
+/* forward declaration */
+static void keep_sample (stats_shard* sh, const client_stats* st);
+static int grow_samples (stats_shard* sh, long size);
+static void print_value (FILE* fp, stat_unit unit, double value);
+
+
+/*
+* Description - Allocates a histogram per phase
+*
+* Input  -      *s        - the statistics to init
+*               precision - significant decimal digits of the histograms
+* Return -      On Success - 0, on Error -1
+*/
+int stats_init (stats* s, int precision)
+{
+	return stats_init_phases (s, precision, ~0u);
+}
+
+
+/*
+* Description - Allocates the histograms of some of the phases only
+*
+* Input  -      *s        - the statistics to init
+*               precision - significant decimal digits of the histograms
+*               phases    - bit mask of the phases to keep, 1 << stat_phase
+* Return -      On Success - 0, on Error -1
+*/
+int stats_init_phases (stats* s, int precision, unsigned int phases)
+{
+	int i;
+
+	memset (s, 0, sizeof (stats));
+
+	for (i = 0; i < PHASE_NUM; i++) {
+		if (!(phases & (1u << i))) {
+			continue;
+		}
+
+		if (hist_init (&s->phase[i], precision) == -1) {
+			fprintf (stderr, "%s - error: hist_init () failed.\n", __func__);
+			stats_free (s);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Releases the histograms
+*
+* Input  -      *s - the statistics
+*/
+void stats_free (stats* s)
+{
+	int i;
+
+	for (i = 0; i < PHASE_NUM; i++) {
+		hist_free (&s->phase[i]);
+	}
+}
+
+
+/*
+* Description - Forgets all the recorded tries, the memory is kept
+*
+* Input  -      *s - the statistics
+*/
+void stats_reset (stats* s)
+{
+	int i;
+
+	for (i = 0; i < PHASE_NUM; i++) {
+		hist_reset (&s->phase[i]);
+	}
+
+	s->tries = 0;
+	s->errors = 0;
+	s->bad_bodies = 0;
+	s->failures = 0;
+	memset (s->curl_codes, 0, sizeof (s->curl_codes));
+	memset (s->status_classes, 0, sizeof (s->status_classes));
+}
+
+
+/*
+* Description - Records the timing phases of a try, O(1)
+*
+* Input  -      *s  - the statistics
+*               *st - the results of the try
+*/
+void stats_record (stats* s, const client_stats* st)
+{
+	int i;
+
+	for (i = 0; i < PHASE_NUM; i++) {
+		if (s->phase[i].counts) {
+			hist_record (&s->phase[i], stats_phase_value (st, i));
+		}
+	}
+
+	s->tries++;
+
+	if (st->resp_code >= 400) {
+		s->errors++;
+	}
+
+	if (st->bad_body) {
+		s->bad_bodies++;
+	}
+
+	if (st->curl_code != CURLE_OK) {
+		s->failures++;
+	}
+
+	if (st->curl_code >= 0 && st->curl_code < CURL_LAST) {
+		s->curl_codes[st->curl_code]++;
+	}
+
+	s->status_classes[st->resp_code >= 100 && st->resp_code < 600 ? st->resp_code / 100 : 0]++;
+}
+
+
+/*
+* Description - Tells, whether a try has failed: its transfer did not
+*               complete, or the server answered with an HTTP error
+*
+* Input  -      *st - the results of the try
+* Return -      1 when failed, 0 otherwise
+*/
+int stats_try_failed (const client_stats* st)
+{
+	return st->curl_code != CURLE_OK || st->resp_code >= 400;
+}
+
+
+/*
+* Description - Adds the statistics of <src> to <dst>
+*
+* Input  -      *dst - the statistics to add to
+*               *src - the statistics to add
+* Return -      On Success - 0, on Error -1
+*/
+int stats_merge (stats* dst, const stats* src)
+{
+	int i;
+
+	for (i = 0; i < PHASE_NUM; i++) {
+		if (hist_merge (&dst->phase[i], &src->phase[i]) == -1) {
+			return -1;
+		}
+	}
+
+	dst->tries += src->tries;
+	dst->errors += src->errors;
+	dst->bad_bodies += src->bad_bodies;
+	dst->failures += src->failures;
+
+	for (i = 0; i < CURL_LAST; i++) {
+		dst->curl_codes[i] += src->curl_codes[i];
+	}
+
+	for (i = 0; i < STATS_STATUS_CLASSES; i++) {
+		dst->status_classes[i] += src->status_classes[i];
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Prints min, mean, percentiles and max of each phase. The
+*               phases, that are zero in all the tries, like TLS time of a
+*               plain HTTP run, are skipped.
+*
+* Input  -      *fp    - the stream to print to
+*               *title - title of the statistics
+*               *s     - the statistics
+*/
+void stats_print (FILE* fp, const char* title, const stats* s)
+{
+	size_t p;
+	int i;
+
+	if (!s->tries) {
+		return;
+	}
+
+	fprintf (fp, "%s (%lld tries, %lld HTTP errors, %lld bad bodies, %lld transfer errors): \n",
+			title, s->tries, s->errors, s->bad_bodies, s->failures);
+
+	/* a plain run of successes needs no breakdown */
+	if (s->errors || s->failures) {
+		stats_print_codes (fp, s);
+	}
+
+	for (i = 0; i < PHASE_NUM; i++) {
+		const hist* h = &s->phase[i];
+		stat_unit unit = phases[i].unit;
+
+		if (!h->max) {
+			continue;
+		}
+
+		fprintf (fp, "  %-18s min ", phases[i].name);
+		print_value (fp, unit, (double) h->min);
+		fprintf (fp, "; mean ");
+		print_value (fp, unit, hist_mean (h));
+		fprintf (fp, ";");
+
+		for (p = 0; p < REPORT_PERCENTILES_NUM; p++) {
+			fprintf (fp, " p%g ", report_percentiles[p]);
+			print_value (fp, unit, (double) hist_value_at_percentile (h, report_percentiles[p]));
+			fprintf (fp, ";");
+		}
+
+		fprintf (fp, " max ");
+		print_value (fp, unit, (double) h->max);
+		fprintf (fp, " %s;\n", unit_suffixes[unit]);
+	}
+}
+
+
+/*
+* Description - Prints the tries by the class of their status and by the
+*               CURLcode of their failed transfers
+*
+* Input  -      *fp - the stream to print to
+*               *s  - the statistics
+*/
+void stats_print_codes (FILE* fp, const stats* s)
+{
+	int i;
+
+	fprintf (fp, "  %-18s", "Status classes");
+
+	for (i = 0; i < STATS_STATUS_CLASSES; i++) {
+		if (!s->status_classes[i]) {
+			continue;
+		}
+		if (i) {
+			fprintf (fp, " %dxx %lld;", i, s->status_classes[i]);
+		} else {
+			fprintf (fp, " none %lld;", s->status_classes[i]);
+		}
+	}
+	fprintf (fp, "\n");
+
+	for (i = 1; i < CURL_LAST; i++) {
+		if (s->curl_codes[i]) {
+			fprintf (fp, "  %-18s %d (%s) %lld;\n", "Transfer errors", i,
+					curl_easy_strerror ((CURLcode) i), s->curl_codes[i]);
+		}
+	}
+}
+
+
+/*
+* Description - Prints a value of a phase, the times in secs
+*
+* Input  -      *fp   - the stream to print to
+*               unit  - unit of the phase
+*               value - the value, times in usec, nsec for UNIT_NSEC
+*/
+static void print_value (FILE* fp, stat_unit unit, double value)
+{
+	if (unit == UNIT_USEC) {
+		fprintf (fp, "%06f", value / 1000000);
+	} else if (unit == UNIT_NSEC) {
+		fprintf (fp, "%.3f", value / 1000);
+	} else {
+		fprintf (fp, "%.0f", value);
+	}
+}
+
+
+/*
+* Description - Inits all the statistics of a worker shard
+*
+* Input  -      *sh          - the shard
+*               precision    - significant decimal digits of the histograms
+*               keep_samples - when true, raw results of each try are kept
+* Return -      On Success - 0, on Error -1
+*/
+int stats_shard_init (stats_shard* sh, int precision, int keep_samples)
+{
+	int i;
+
+	memset (sh, 0, sizeof (stats_shard));
+	sh->keep_samples = keep_samples;
+
+	if (stats_init (&sh->all, precision) == -1 ||
+			stats_init (&sh->cold, precision) == -1 ||
+			stats_init (&sh->warm, precision) == -1 ||
+			stats_init_phases (&sh->ok, precision, URL_STATS_PHASES) == -1 ||
+			stats_init_phases (&sh->failed, precision, URL_STATS_PHASES) == -1 ||
+			stats_map_init (&sh->statuses, precision) == -1 ||
+			stats_map_init (&sh->servers, precision) == -1) {
+		stats_shard_free (sh);
+		return -1;
+	}
+
+	for (i = 0; i < DNS_MODES_NUM; i++) {
+		if (stats_init_phases (&sh->dns[i], precision, DNS_STATS_PHASES) == -1) {
+			stats_shard_free (sh);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Adds the double-buffered interval statistics to a worker shard
+*
+* Input  -      *sh       - the shard
+*               precision - significant decimal digits of the histograms
+* Return -      On Success - 0, on Error -1
+*/
+int stats_shard_init_interval (stats_shard* sh, int precision)
+{
+	if (!(sh->interval = (interval_recorder *) calloc (1, sizeof (interval_recorder)))) {
+		fprintf (stderr, "%s - error: allocation of interval stats failed.\n", __func__);
+		return -1;
+	}
+
+	if (stats_init (&sh->interval->buf[0], precision) == -1 ||
+			stats_init (&sh->interval->buf[1], precision) == -1) {
+		return -1;
+	}
+
+	atomic_init (&sh->interval->active, 0);
+	atomic_init (&sh->interval->enter, 0);
+	atomic_init (&sh->interval->leave, 0);
+
+	return 0;
+}
+
+
+/*
+* Description - Adds the statistics per url of the workload to a worker shard
+*
+* Input  -      *sh       - the shard
+*               precision - significant decimal digits of the histograms
+*               urls_num  - number of the urls
+* Return -      On Success - 0, on Error -1
+*/
+int stats_shard_init_urls (stats_shard* sh, int precision, int urls_num)
+{
+	int i;
+
+	if (!(sh->urls = (stats *) calloc (urls_num, sizeof (stats)))) {
+		fprintf (stderr, "%s - error: allocation of %d url stats failed.\n",
+				__func__, urls_num);
+		return -1;
+	}
+	sh->urls_num = urls_num;
+
+	for (i = 0; i < urls_num; i++) {
+		if (stats_init_phases (&sh->urls[i], precision, URL_STATS_PHASES) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Adds the statistics per rank bucket of the keys of the
+*               KEYSPACE to a worker shard
+*
+* Input  -      *sh       - the shard
+*               precision - significant decimal digits of the histograms
+*               keys_num  - number of the rank buckets
+* Return -      On Success - 0, on Error -1
+*/
+int stats_shard_init_keys (stats_shard* sh, int precision, int keys_num)
+{
+	int i;
+
+	if (!(sh->keys = (stats *) calloc (keys_num, sizeof (stats)))) {
+		fprintf (stderr, "%s - error: allocation of %d key stats failed.\n",
+				__func__, keys_num);
+		return -1;
+	}
+	sh->keys_num = keys_num;
+
+	for (i = 0; i < keys_num; i++) {
+		if (stats_init_phases (&sh->keys[i], precision, URL_STATS_PHASES) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Allocates the kept samples for a known number of tries up
+*               front, so that no try of the run has to grow them
+*
+* Input  -      *sh   - the shard, keeping samples
+*               tries - number of the tries of the worker
+* Return -      On Success - 0, on Error -1
+*/
+int stats_shard_reserve_samples (stats_shard* sh, long tries)
+{
+	if (!sh->keep_samples || tries <= sh->samples_size) {
+		return 0;
+	}
+
+	if (grow_samples (sh, tries) == -1) {
+		fprintf (stderr, "%s - error: allocation of %ld samples failed.\n",
+				__func__, tries);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Releases the statistics of a worker shard
+*
+* Input  -      *sh - the shard
+*/
+void stats_shard_free (stats_shard* sh)
+{
+	int i;
+
+	stats_free (&sh->all);
+	stats_free (&sh->cold);
+	stats_free (&sh->warm);
+	stats_free (&sh->ok);
+	stats_free (&sh->failed);
+	stats_map_free (&sh->statuses);
+	stats_map_free (&sh->servers);
+
+	for (i = 0; i < DNS_MODES_NUM; i++) {
+		stats_free (&sh->dns[i]);
+	}
+
+	for (i = 0; i < sh->urls_num; i++) {
+		stats_free (&sh->urls[i]);
+	}
+	free (sh->urls);
+	sh->urls = NULL;
+	sh->urls_num = 0;
+
+	for (i = 0; i < sh->keys_num; i++) {
+		stats_free (&sh->keys[i]);
+	}
+	free (sh->keys);
+	sh->keys = NULL;
+	sh->keys_num = 0;
+
+	if (sh->interval) {
+		stats_free (&sh->interval->buf[0]);
+		stats_free (&sh->interval->buf[1]);
+		free (sh->interval);
+		sh->interval = NULL;
+	}
+
+	for (i = 0; i < PHASE_NUM; i++) {
+		free (sh->samples[i]);
+		sh->samples[i] = NULL;
+	}
+
+	free (sh->samples_send_time);
+	free (sh->samples_num_connects);
+	free (sh->samples_resp_code);
+	free (sh->samples_curl_code);
+	free (sh->samples_bad_body);
+	free (sh->samples_url_id);
+	free (sh->samples_server_ip);
+	sh->samples_send_time = NULL;
+	sh->samples_num_connects = NULL;
+	sh->samples_resp_code = NULL;
+	sh->samples_curl_code = NULL;
+	sh->samples_bad_body = NULL;
+	sh->samples_url_id = NULL;
+	sh->samples_server_ip = NULL;
+	sh->samples_num = sh->samples_size = 0;
+}
+
+
+/*
+* Description - Records a try to the shard, splitting new and reused connections
+*
+* Input  -      *sh - the shard
+*               *st - the results of the try
+*/
+void stats_shard_record (stats_shard* sh, const client_stats* st)
+{
+	char status[24];
+
+	stats_record (&sh->all, st);
+	/* a failed try without a response has not reused a connection, it
+	   has failed to make one: counted as cold, not as warm */
+	stats_record (st->num_connects || (st->curl_code != CURLE_OK && !st->resp_code) ?
+			&sh->cold : &sh->warm, st);
+	stats_record (stats_try_failed (st) ? &sh->failed : &sh->ok, st);
+
+	/* a slow backend or a fast error path shows up by its own latency */
+	if (st->resp_code) {
+		snprintf (status, sizeof (status), "%ld", st->resp_code);
+	} else {
+		strcpy (status, "none");
+	}
+	stats_map_record (&sh->statuses, status, st);
+	stats_map_record (&sh->servers, st->server_ip[0] ? st->server_ip : "none", st);
+
+	if (st->dns_mode > DNS_MODE_DEFAULT && st->dns_mode < DNS_MODES_NUM) {
+		stats_record (&sh->dns[st->dns_mode], st);
+	}
+
+	if (sh->urls) {
+		stats_record (&sh->urls[st->url_id], st);
+	}
+
+	if (sh->keys && st->key_rank) {
+		int bucket = keyspace_bucket (st->key_rank);
+
+		if (bucket < sh->keys_num) {
+			stats_record (&sh->keys[bucket], st);
+		}
+	}
+
+	if (sh->interval) {
+		interval_recorder* rec = sh->interval;
+
+		atomic_fetch_add (&rec->enter, 1);
+		stats_record (&rec->buf[atomic_load (&rec->active)], st);
+		atomic_fetch_add (&rec->leave, 1);
+	}
+
+	if (sh->keep_samples) {
+		keep_sample (sh, st);
+	}
+}
+
+
+/*
+* Description - Adds the statistics of one shard to another one
+*
+* Input  -      *dst - the shard to add to
+*               *src - the shard to add
+* Return -      On Success - 0, on Error -1
+*/
+int stats_shard_merge (stats_shard* dst, const stats_shard* src)
+{
+	int i;
+
+	if (stats_merge (&dst->all, &src->all) == -1 ||
+			stats_merge (&dst->cold, &src->cold) == -1 ||
+			stats_merge (&dst->warm, &src->warm) == -1 ||
+			stats_merge (&dst->ok, &src->ok) == -1 ||
+			stats_merge (&dst->failed, &src->failed) == -1 ||
+			stats_map_merge (&dst->statuses, &src->statuses) == -1 ||
+			stats_map_merge (&dst->servers, &src->servers) == -1) {
+		return -1;
+	}
+
+	for (i = 0; i < DNS_MODES_NUM; i++) {
+		if (stats_merge (&dst->dns[i], &src->dns[i]) == -1) {
+			return -1;
+		}
+	}
+
+	for (i = 0; i < dst->urls_num && i < src->urls_num; i++) {
+		if (stats_merge (&dst->urls[i], &src->urls[i]) == -1) {
+			return -1;
+		}
+	}
+
+	for (i = 0; i < dst->keys_num && i < src->keys_num; i++) {
+		if (stats_merge (&dst->keys[i], &src->keys[i]) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Swaps the buffers of an interval recorder. Called by the
+*               reporter thread. The worker records into the other buffer
+*               right after the swap, a record started before it is waited
+*               for to finish.
+*
+* Input  -      *rec - the interval recorder
+* Return -      The buffer of the finished interval, the caller resets it
+*               after reading
+*/
+stats* interval_recorder_swap (interval_recorder* rec)
+{
+	int inactive = atomic_load (&rec->active);
+	long long entered;
+
+	atomic_store (&rec->active, !inactive);
+
+	/* records entered so far might still be writing to the old buffer */
+	entered = atomic_load (&rec->enter);
+
+	while (atomic_load (&rec->leave) < entered) {
+		sched_yield ();
+	}
+
+	return &rec->buf[inactive];
+}
+
+
+/*
+* Description - Writes the header line of the samples CSV
+*
+* Input  -      *fp - the stream to write to
+*/
+void stats_write_samples_header (FILE* fp)
+{
+	int p;
+
+	fprintf (fp, "worker,send_time");
+
+	for (p = 0; p < PHASE_NUM; p++) {
+		fprintf (fp, ",%s", phases[p].key);
+	}
+
+	/* the columns of a try follow the ones of the trace */
+	fprintf (fp, ",num_connects,resp_code,curl_code,bad_body,url_id,server_ip\n");
+}
+
+
+/*
+* Description - Writes the kept raw results of the tries as CSV lines
+*
+* Input  -      *fp      - the stream to write to
+*               shard_id - id of the shard, written as the first column
+*               *sh      - the shard
+*/
+void stats_shard_write_samples (FILE* fp, int shard_id, const stats_shard* sh)
+{
+	long i;
+	int p;
+
+	for (i = 0; i < sh->samples_num; i++) {
+		fprintf (fp, "%d,%lld", shard_id, sh->samples_send_time[i]);
+
+		for (p = 0; p < PHASE_NUM; p++) {
+			fprintf (fp, ",%lld", sh->samples[p][i]);
+		}
+
+		fprintf (fp, ",%ld,%ld,%ld,%d,%d,%s\n", sh->samples_num_connects[i],
+				sh->samples_resp_code[i], sh->samples_curl_code[i],
+				sh->samples_bad_body[i], sh->samples_url_id[i],
+				sh->samples_server_ip[i]);
+	}
+}
+
+
+/*
+* Description - Appends the raw results of a try to the kept samples, doubling
+*               the memory when exhausted. On allocation failure the samples
+*               are not kept any more.
+*
+* Input  -      *sh - the shard
+*               *st - the results of the try
+*/
+static void keep_sample (stats_shard* sh, const client_stats* st)
+{
+	long i = sh->samples_num;
+	int p;
+
+	if (i == sh->samples_size) {
+		long size = sh->samples_size ? sh->samples_size * 2 : SAMPLES_INITIAL_SIZE;
+
+		if (grow_samples (sh, size) == -1) {
+			fprintf (stderr, "%s - error: allocation of %ld samples failed, "
+					"samples are not kept any more.\n", __func__, size);
+			sh->keep_samples = 0;
+			return;
+		}
+	}
+
+	for (p = 0; p < PHASE_NUM; p++) {
+		sh->samples[p][i] = stats_phase_value (st, p);
+	}
+
+	sh->samples_send_time[i] = st->send_time;
+	sh->samples_num_connects[i] = st->num_connects;
+	sh->samples_resp_code[i] = st->resp_code;
+	sh->samples_curl_code[i] = st->curl_code;
+	sh->samples_bad_body[i] = st->bad_body;
+	sh->samples_url_id[i] = st->url_id;
+	memcpy (sh->samples_server_ip[i], st->server_ip, sizeof (st->server_ip));
+
+	sh->samples_num++;
+}
+
+
+/* reallocates a column of the samples, keeping the old one on failure */
+#define GROW_COLUMN(column, size) \
+	do { \
+		void* tmp = realloc ((column), (size) * sizeof (*(column))); \
+		if (!tmp) { \
+			return -1; \
+		} \
+		(column) = tmp; \
+	} while (0)
+
+/*
+* Description - Grows the columns of the kept samples
+*
+* Input  -      *sh  - the shard
+*               size - new number of the samples
+* Return -      On Success - 0, on Error -1
+*/
+static int grow_samples (stats_shard* sh, long size)
+{
+	int p;
+
+	for (p = 0; p < PHASE_NUM; p++) {
+		GROW_COLUMN (sh->samples[p], size);
+	}
+
+	GROW_COLUMN (sh->samples_send_time, size);
+	GROW_COLUMN (sh->samples_num_connects, size);
+	GROW_COLUMN (sh->samples_resp_code, size);
+	GROW_COLUMN (sh->samples_curl_code, size);
+	GROW_COLUMN (sh->samples_bad_body, size);
+	GROW_COLUMN (sh->samples_url_id, size);
+	GROW_COLUMN (sh->samples_server_ip, size);
+
+	sh->samples_size = size;
+
+	return 0;
+}
+
+
+/*
+* Description - Name of a phase
+*
+* Input  -      phase - the phase
+* Return -      The name
+*/
+const char* stats_phase_name (stat_phase phase)
+{
+	return phase < PHASE_NUM ? phases[phase].name : "unknown";
+}
+
+
+/*
+* Description - Name of a phase, as a CSV column or JSON key
+*
+* Input  -      phase - the phase
+* Return -      The name
+*/
+const char* stats_phase_key (stat_phase phase)
+{
+	return phase < PHASE_NUM ? phases[phase].key : "unknown";
+}
+
+
+/*
+* Description - Unit of a phase
+*
+* Input  -      phase - the phase
+* Return -      The unit
+*/
+stat_unit stats_phase_unit (stat_phase phase)
+{
+	return phases[phase].unit;
+}
+
+
+/*
+* Description - Value of a phase in the results of a try
+*
+* Input  -      *st   - the results of the try
+*               phase - the phase
+* Return -      The value
+*/
+long long stats_phase_value (const client_stats* st, stat_phase phase)
+{
+	return (long long) *(const curl_off_t *) ((const char *) st + phases[phase].offset);
+}
+
+
+/*
+* Description - Sets the value of a phase in the results of a try
+*
+* Input  -      *st   - the results of the try
+*               phase - the phase
+*               value - the value
+*/
+void stats_phase_set (client_stats* st, stat_phase phase, long long value)
+{
+	*(curl_off_t *) ((char *) st + phases[phase].offset) = (curl_off_t) value;
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
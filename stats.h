@@ -0,0 +1,201 @@
+/*
+ *     stats.h
+ *
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <curl/curl.h>
+
+#include "hist.h"
+#include "stats_map.h"
+#include "url.h"
+
+struct client_stats;
+
+/* Timing phases and sizes of a try, each one gets a histogram */
+typedef enum stat_phase {
+	PHASE_TOTAL = 0,
+	PHASE_NAMELOOKUP,
+	PHASE_CONNECT,
+	PHASE_APPCONNECT,
+	PHASE_PRETRANSFER,
+	PHASE_START_TRANSFER,
+	PHASE_REDIRECT,
+	PHASE_RESPONSE,
+	PHASE_REDIRECT_COUNT,
+	PHASE_SIZE_UPLOAD,
+	PHASE_SIZE_DOWNLOAD,
+	PHASE_SPEED_UPLOAD,
+	PHASE_SPEED_DOWNLOAD,
+	PHASE_HEADER_SIZE,
+	PHASE_SETUP,
+
+	PHASE_NUM,
+} stat_phase;
+
+/* Units of the phases */
+typedef enum stat_unit {
+	UNIT_USEC = 0,
+	UNIT_COUNT,
+	UNIT_BYTES,
+	UNIT_BYTES_PER_SEC,
+	UNIT_NSEC,
+} stat_unit;
+
+/* Phases, a stats of a url of the workload keeps the histograms of. The
+   other ones are kept for the whole run only.  */
+#define URL_STATS_PHASES ((1u << PHASE_TOTAL) | (1u << PHASE_START_TRANSFER) | \
+		(1u << PHASE_RESPONSE))
+
+/* Phases, a stats of a DNS mode keeps the histograms of */
+#define DNS_STATS_PHASES ((1u << PHASE_TOTAL) | (1u << PHASE_NAMELOOKUP) | \
+		(1u << PHASE_CONNECT))
+
+/* Longest server ip of a try with its terminator, INET6_ADDRSTRLEN */
+#define STATS_IP_SIZE 46
+
+/* Status classes counted: none (no response), 1xx to 5xx */
+#define STATS_STATUS_CLASSES 6
+
+/* Aggregated statistics of a set of tries */
+typedef struct stats {
+
+	/* Histogram of each phase, times in usec. The phases left out by
+	   stats_init_phases () have no counters and are not recorded.  */
+	hist phase[PHASE_NUM];
+
+	/* Number of the recorded tries */
+	long long tries;
+
+	/* Tries answered with HTTP status 400 or above */
+	long long errors;
+
+	/* Successful tries, whose body is not as expected */
+	long long bad_bodies;
+
+	/* Tries, whose transfer has failed, and the count of each CURLcode */
+	long long failures;
+	long long curl_codes[CURL_LAST];
+
+	/* Tries by the class of the status, 0 for no response, 1 to 5 for 1xx
+	   to 5xx  */
+	long long status_classes[STATS_STATUS_CLASSES];
+
+} stats;
+
+/* Statistics of the current reporting interval. The worker records into the
+   active buffer, the reporter swaps the buffers and reads the inactive one.
+   The enter/leave counters let the reporter wait for a record in progress
+   into the buffer just made inactive, the worker never waits.  */
+typedef struct interval_recorder {
+
+	/* The two buffers */
+	stats buf[2];
+
+	/* Index of the buffer the worker records into */
+	atomic_int active;
+
+	/* Records started and finished by the worker */
+	atomic_llong enter;
+	atomic_llong leave;
+
+} interval_recorder;
+
+/* Statistics shard of a worker, recorded by the worker thread only */
+typedef struct stats_shard {
+
+	/* All the tries */
+	stats all;
+
+	/* Tries on new connections */
+	stats cold;
+
+	/* Tries on reused connections */
+	stats warm;
+
+	/* Successful tries and the failed ones, by transfer or HTTP status */
+	stats ok;
+	stats failed;
+
+	/* Tries by their status code and by the ip of their server */
+	stats_map statuses;
+	stats_map servers;
+
+	/* Tries by the DNS mode of their url, DNS_MODE_* */
+	stats dns[DNS_MODES_NUM];
+
+	/* Tries of each url of the workload, NULL for a single url */
+	stats* urls;
+	int urls_num;
+
+	/* Tries of each rank bucket of the keys, NULL without a KEYSPACE */
+	stats* keys;
+	int keys_num;
+
+	/* Statistics of the reporting interval, NULL without interval reports */
+	interval_recorder* interval;
+
+	/* Flag; whether the raw results of each try are kept */
+	int keep_samples;
+
+	/* Raw results of each try, kept only when requested. The memory
+	   grows with the number of tries, unlike the one of the histograms.
+	   Kept as a column per phase, so that the passes over a phase run
+	   over contiguous memory.  */
+	long long* samples[PHASE_NUM];
+	long long* samples_send_time;
+	long* samples_num_connects;
+	long* samples_resp_code;
+	long* samples_curl_code;
+	int* samples_bad_body;
+	int* samples_url_id;
+	char (*samples_server_ip)[STATS_IP_SIZE];
+	long samples_num;
+	long samples_size;
+
+} stats_shard;
+
+int stats_init (stats* s, int precision);
+int stats_init_phases (stats* s, int precision, unsigned int phases);
+void stats_free (stats* s);
+void stats_reset (stats* s);
+void stats_record (stats* s, const struct client_stats* st);
+int stats_merge (stats* dst, const stats* src);
+void stats_print (FILE* fp, const char* title, const stats* s);
+void stats_print_codes (FILE* fp, const stats* s);
+int stats_try_failed (const struct client_stats* st);
+
+int stats_shard_init (stats_shard* sh, int precision, int keep_samples);
+int stats_shard_init_interval (stats_shard* sh, int precision);
+int stats_shard_init_urls (stats_shard* sh, int precision, int urls_num);
+int stats_shard_init_keys (stats_shard* sh, int precision, int keys_num);
+int stats_shard_reserve_samples (stats_shard* sh, long tries);
+void stats_shard_free (stats_shard* sh);
+void stats_shard_record (stats_shard* sh, const struct client_stats* st);
+int stats_shard_merge (stats_shard* dst, const stats_shard* src);
+void stats_write_samples_header (FILE* fp);
+void stats_shard_write_samples (FILE* fp, int shard_id, const stats_shard* sh);
+
+/* Swaps the buffers of the recorder, returns the one to read and reset */
+stats* interval_recorder_swap (interval_recorder* rec);
+
+/* Name of a phase, as printed in the reports */
+const char* stats_phase_name (stat_phase phase);
+
+/* Name of a phase, as a CSV column or JSON key */
+const char* stats_phase_key (stat_phase phase);
+
+/* Unit of a phase */
+stat_unit stats_phase_unit (stat_phase phase);
+
+/* Value of a phase in the results of a try */
+long long stats_phase_value (const struct client_stats* st, stat_phase phase);
+
+/* Sets the value of a phase in the results of a try */
+void stats_phase_set (struct client_stats* st, stat_phase phase, long long value);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,246 @@
+/*
+ *     stats_map.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "conf.h"
+#include "stats.h"
+#include "stats_map.h"
+
+/* Most keys of a map, the load is kept low for short probes */
+#define STATS_MAP_KEYS_MAX (STATS_MAP_SIZE / 4 * 3)
+
+/* forward declaration */
+static stats_map_entry* find_slot (const stats_map* m, const char* key);
+static stats* get_stats (stats_map* m, const char* key);
+static int compare_keys (const void* a, const void* b);
+
+
+/*
+* Description - Allocates the slots of an empty map. The statistics of a key
+*               are allocated with its first try.
+*
+* Input  -      *m        - the map
+*               precision - significant decimal digits of the histograms
+* Return -      On Success - 0, on Error -1
+*/
+int stats_map_init (stats_map* m, int precision)
+{
+	memset (m, 0, sizeof (stats_map));
+	m->precision = precision;
+
+	if (!(m->entries = (stats_map_entry *) calloc (STATS_MAP_SIZE,
+					sizeof (stats_map_entry)))) {
+		fprintf (stderr, "%s - error: allocation of the map failed.\n", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Releases the map and the statistics of its keys
+*
+* Input  -      *m - the map
+*/
+void stats_map_free (stats_map* m)
+{
+	int i;
+
+	for (i = 0; m->entries && i < STATS_MAP_SIZE; i++) {
+		if (m->entries[i].stats) {
+			stats_free (m->entries[i].stats);
+			free (m->entries[i].stats);
+		}
+	}
+
+	free (m->entries);
+	memset (m, 0, sizeof (stats_map));
+}
+
+
+/*
+* Description - Records a try to the statistics of its key. A new key is
+*               added, while the map has room; the tries of the keys, that
+*               have found it full, are counted as others.
+*
+* Input  -      *m   - the map
+*               *key - the key of the try
+*               *st  - the results of the try
+*/
+void stats_map_record (stats_map* m, const char* key, const client_stats* st)
+{
+	stats* s = get_stats (m, key);
+
+	if (s) {
+		stats_record (s, st);
+	} else {
+		m->others++;
+	}
+}
+
+
+/*
+* Description - Adds the keys and statistics of one map to another one
+*
+* Input  -      *dst - the map to add to
+*               *src - the map to add
+* Return -      On Success - 0, on Error -1
+*/
+int stats_map_merge (stats_map* dst, const stats_map* src)
+{
+	stats* s;
+	int i;
+
+	for (i = 0; i < STATS_MAP_SIZE; i++) {
+		const stats_map_entry* e = &src->entries[i];
+
+		if (!e->stats) {
+			continue;
+		}
+
+		if (!(s = get_stats (dst, e->key))) {
+			dst->others += e->stats->tries;
+			continue;
+		}
+
+		if (stats_merge (s, e->stats) == -1) {
+			return -1;
+		}
+	}
+
+	dst->others += src->others;
+
+	return 0;
+}
+
+
+/*
+* Description - Prints the statistics of each key, the keys ordered by their
+*               length, then alphabetically: status codes and ipv4
+*               addresses come out in their natural order
+*
+* Input  -      *fp    - the stream to print to
+*               *title - title of the statistics, followed by the key
+*               *m     - the map
+*/
+void stats_map_print (FILE* fp, const char* title, const stats_map* m)
+{
+	const stats_map_entry* sorted[STATS_MAP_SIZE];
+	char line[STATS_MAP_KEY_SIZE + 64];
+	int num = 0;
+	int i;
+
+	for (i = 0; i < STATS_MAP_SIZE; i++) {
+		if (m->entries[i].stats) {
+			sorted[num++] = &m->entries[i];
+		}
+	}
+
+	qsort (sorted, num, sizeof (sorted[0]), compare_keys);
+
+	for (i = 0; i < num; i++) {
+		snprintf (line, sizeof (line), "%s %s", title, sorted[i]->key);
+		stats_print (fp, line, sorted[i]->stats);
+	}
+
+	if (m->others) {
+		fprintf (fp, "%s: %lld tries more, beyond %d keys, are not broken down;\n",
+				title, m->others, STATS_MAP_KEYS_MAX);
+	}
+}
+
+
+/*
+* Description - Finds the slot of a key by linear probing from its FNV-1a
+*               hash: the one holding the key or the free one, it would go to
+*
+* Input  -      *m   - the map
+*               *key - the key
+* Return -      The slot, NULL when the key is not there and no slot is free
+*/
+static stats_map_entry* find_slot (const stats_map* m, const char* key)
+{
+	uint32_t hash = 2166136261u;
+	const unsigned char* c;
+	int i;
+
+	for (c = (const unsigned char *) key; *c; c++) {
+		hash = (hash ^ *c) * 16777619u;
+	}
+
+	for (i = 0; i < STATS_MAP_SIZE; i++) {
+		stats_map_entry* e = &m->entries[(hash + i) & (STATS_MAP_SIZE - 1)];
+
+		if (!e->stats || !strcmp (e->key, key)) {
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+* Description - Gets the statistics of a key, adding the key when new
+*
+* Input  -      *m   - the map
+*               *key - the key
+* Return -      The statistics, NULL when the map is full
+*/
+static stats* get_stats (stats_map* m, const char* key)
+{
+	stats_map_entry* e = find_slot (m, key);
+	stats* s;
+
+	if (!e) {
+		return NULL;
+	}
+
+	if (e->stats) {
+		return e->stats;
+	}
+
+	if (m->keys_num >= STATS_MAP_KEYS_MAX) {
+		return NULL;
+	}
+
+	/* once per key, the first try of it allocates */
+	if (!(s = (stats *) malloc (sizeof (stats)))) {
+		return NULL;
+	}
+
+	if (stats_init_phases (s, m->precision, URL_STATS_PHASES) == -1) {
+		free (s);
+		return NULL;
+	}
+
+	snprintf (e->key, sizeof (e->key), "%s", key);
+	e->stats = s;
+	m->keys_num++;
+
+	return s;
+}
+
+
+/* qsort () comparison of the keys of two entries, shorter keys first */
+static int compare_keys (const void* a, const void* b)
+{
+	const stats_map_entry* ea = *(const stats_map_entry* const *) a;
+	const stats_map_entry* eb = *(const stats_map_entry* const *) b;
+	size_t la = strlen (ea->key);
+	size_t lb = strlen (eb->key);
+
+	if (la != lb) {
+		return la < lb ? -1 : 1;
+	}
+
+	return strcmp (ea->key, eb->key);
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
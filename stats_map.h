@@ -0,0 +1,60 @@
+/*
+ *     stats_map.h
+ *
+ */
+#ifndef STATS_MAP_H
+#define STATS_MAP_H
+
+#include <stdio.h>
+
+struct stats;
+struct client_stats;
+
+/* Longest key, an IPv6 address in text with its terminator fits */
+#define STATS_MAP_KEY_SIZE 48
+
+/* Slots of a map, a power of two. Up to 3/4 of them get a key, the tries
+   of the keys beyond are counted as others.  */
+#define STATS_MAP_SIZE 64
+
+/* A key and its statistics, NULL while the slot is free */
+typedef struct stats_map_entry {
+	char key[STATS_MAP_KEY_SIZE];
+	struct stats* stats;
+} stats_map_entry;
+
+/* Small open-addressing (linear probing) table of statistics by a string
+   key: a status code or a server ip. Recorded by the worker thread only.  */
+typedef struct stats_map {
+
+	/* STATS_MAP_SIZE slots */
+	stats_map_entry* entries;
+
+	/* Keys in the map */
+	int keys_num;
+
+	/* Significant decimal digits of the histograms of a new key */
+	int precision;
+
+	/* Tries, that have found the map full */
+	long long others;
+
+} stats_map;
+
+/* Allocates the slots of an empty map */
+int stats_map_init (stats_map* m, int precision);
+
+/* Releases the map and the statistics of its keys */
+void stats_map_free (stats_map* m);
+
+/* Records a try to the statistics of its key, adding the key when new */
+void stats_map_record (stats_map* m, const char* key, const struct client_stats* st);
+
+/* Adds the keys and statistics of <src> to <dst> */
+int stats_map_merge (stats_map* dst, const stats_map* src);
+
+/* Prints the statistics of each key, in the order of the keys */
+void stats_map_print (FILE* fp, const char* title, const stats_map* m);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
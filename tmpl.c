@@ -0,0 +1,342 @@
+/*
+ *     tmpl.c
+ *
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tmpl.h"
+
+/* Longest renderings of the placeholders */
+#define TMPL_NUMBER_MAX_LEN 20
+#define TMPL_UUID_LEN 36
+#define TMPL_WORKER_MAX_LEN 11
+
+/* forward declaration */
+static int add_part (tmpl* t, const tmpl_part* part);
+static int parse_placeholder (const char* name, size_t len, tmpl_part* part);
+static char* render_uuid (char* p, rng_state* rng);
+
+
+/*
+* Description - Compiles a string with {{placeholders}} into literal and
+*               variable parts. A string without placeholders is left with
+*               no parts, its users send it as it is.
+*
+* Input  -      *t    - the template to compile
+*               *str  - the string, not necessarily zero terminated
+*               len   - length of the string
+*               flags - TMPL_STRICT, TMPL_COPY
+* Return -      On Success - 0, on Error -1
+*/
+int tmpl_compile (tmpl* t, const char* str, size_t len, int flags)
+{
+	const char* end = str + len;
+	const char* lit = str;
+	const char* p = str;
+	int dynamic = 0;
+
+	memset (t, 0, sizeof (tmpl));
+
+	/* cheap check first, the bodies may be large */
+	if (!memmem (str, len, "{{", 2)) {
+		t->max_len = len;
+		return 0;
+	}
+
+	if (flags & TMPL_COPY) {
+		if (!(t->copy = (char *) malloc (len + 1))) {
+			fprintf (stderr, "%s - error: allocation of %zu bytes failed.\n",
+					__func__, len + 1);
+			return -1;
+		}
+		memcpy (t->copy, str, len);
+		t->copy[len] = '\0';
+
+		str = lit = p = t->copy;
+		end = str + len;
+	}
+
+	while ((p = (const char *) memmem (p, (size_t) (end - p), "{{", 2))) {
+		const char* close = (const char *) memmem (p + 2, (size_t) (end - p - 2), "}}", 2);
+		tmpl_part part;
+
+		if (!close || parse_placeholder (p + 2, (size_t) (close - p - 2), &part) == -1) {
+			if (flags & TMPL_STRICT) {
+				fprintf (stderr, "%s - error: unknown placeholder in \"%.*s\".\n",
+						__func__, (int) len, str);
+				tmpl_free (t);
+				return -1;
+			}
+			/* kept as the text it is */
+			p += 2;
+			continue;
+		}
+
+		if (p > lit) {
+			tmpl_part text = { TMPL_LITERAL, lit, (size_t) (p - lit), 0, 0 };
+
+			if (add_part (t, &text) == -1) {
+				tmpl_free (t);
+				return -1;
+			}
+		}
+
+		if (add_part (t, &part) == -1) {
+			tmpl_free (t);
+			return -1;
+		}
+
+		dynamic = 1;
+		lit = p = close + 2;
+	}
+
+	if (!dynamic) {
+		tmpl_free (t);
+		t->max_len = len;
+		return 0;
+	}
+
+	if (end > lit) {
+		tmpl_part text = { TMPL_LITERAL, lit, (size_t) (end - lit), 0, 0 };
+
+		if (add_part (t, &text) == -1) {
+			tmpl_free (t);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Releases the parts and the copy of the string of a template
+*
+* Input  -      *t - the template
+*/
+void tmpl_free (tmpl* t)
+{
+	free (t->parts);
+	free (t->copy);
+	memset (t, 0, sizeof (tmpl));
+}
+
+
+/*
+* Description - Tells, whether the template has placeholders
+*
+* Input  -      *t - the template
+* Return -      1 when it is to be rendered per try, 0 otherwise
+*/
+int tmpl_dynamic (const tmpl* t)
+{
+	return t->parts != NULL;
+}
+
+
+/*
+* Description - Tells, whether the template has a placeholder of a type
+*
+* Input  -      *t   - the template
+*               type - the type of the placeholder
+* Return -      1 when it has one, 0 otherwise
+*/
+int tmpl_uses (const tmpl* t, tmpl_part_type type)
+{
+	int i;
+
+	for (i = 0; i < t->parts_num; i++) {
+		if (t->parts[i].type == type) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Renders the template for a try into the arena. The room for
+*               the longest rendering is checked once, the parts are written
+*               without further checks.
+*
+* Input  -      *t    - the template, with placeholders
+*               *vars - values of the placeholders for the try
+*               *a    - the arena of the handle
+* Output -      *len  - length of the rendered string, when not NULL
+* Return -      The zero terminated string, NULL when the arena is full
+*/
+char* tmpl_render (const tmpl* t, const tmpl_vars* vars, arena* a, size_t* len)
+{
+	char* out = a->base + a->used;
+	char* p = out;
+	struct timespec ts;
+	int i;
+
+	if (t->max_len + 1 > a->size - a->used) {
+		fprintf (stderr, "%s - error: arena of %zu bytes is full.\n", __func__, a->size);
+		return NULL;
+	}
+
+	for (i = 0; i < t->parts_num; i++) {
+		const tmpl_part* part = &t->parts[i];
+
+		switch (part->type) {
+		case TMPL_LITERAL:
+			memcpy (p, part->text, part->len);
+			p += part->len;
+			break;
+		case TMPL_SEQ:
+			p += sprintf (p, "%lld", vars->seq);
+			break;
+		case TMPL_RAND:
+			p += sprintf (p, "%llu", (unsigned long long)
+					rng_range (vars->rng, part->low, part->high));
+			break;
+		case TMPL_UUID:
+			p = render_uuid (p, vars->rng);
+			break;
+		case TMPL_WORKER:
+			p += sprintf (p, "%d", vars->worker);
+			break;
+		case TMPL_NOW_MS:
+			clock_gettime (CLOCK_REALTIME, &ts);
+			p += sprintf (p, "%lld", (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+			break;
+		case TMPL_KEY:
+			p += sprintf (p, "%llu", (unsigned long long) vars->key);
+			break;
+		}
+	}
+
+	*p = '\0';
+
+	if (len) {
+		*len = (size_t) (p - out);
+	}
+
+	return (char *) arena_alloc (a, (size_t) (p - out) + 1);
+}
+
+
+/*
+* Description - Appends a part to a template
+*
+* Input  -      *t    - the template
+*               *part - the part
+* Return -      On Success - 0, on Error -1
+*/
+static int add_part (tmpl* t, const tmpl_part* part)
+{
+	tmpl_part* parts;
+
+	if (!(parts = (tmpl_part *) realloc (t->parts, (t->parts_num + 1) * sizeof (tmpl_part)))) {
+		fprintf (stderr, "%s - error: allocation of template parts failed.\n", __func__);
+		return -1;
+	}
+
+	t->parts = parts;
+	t->parts[t->parts_num++] = *part;
+
+	switch (part->type) {
+	case TMPL_LITERAL:
+		t->max_len += part->len;
+		break;
+	case TMPL_UUID:
+		t->max_len += TMPL_UUID_LEN;
+		break;
+	case TMPL_WORKER:
+		t->max_len += TMPL_WORKER_MAX_LEN;
+		break;
+	default:
+		t->max_len += TMPL_NUMBER_MAX_LEN;
+		break;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Parses the name of a placeholder, between the braces
+*
+* Input  -      *name - the name
+*               len   - length of the name
+* Output -      *part - the variable part
+* Return -      On Success - 0, -1 for an unknown name
+*/
+static int parse_placeholder (const char* name, size_t len, tmpl_part* part)
+{
+	unsigned long long low, high;
+	char range[64];
+	int n = 0;
+
+	memset (part, 0, sizeof (tmpl_part));
+
+	if (len == 3 && !strncmp (name, "seq", 3)) {
+		part->type = TMPL_SEQ;
+	} else if (len == 4 && !strncmp (name, "uuid", 4)) {
+		part->type = TMPL_UUID;
+	} else if (len == 6 && !strncmp (name, "worker", 6)) {
+		part->type = TMPL_WORKER;
+	} else if (len == 6 && !strncmp (name, "now_ms", 6)) {
+		part->type = TMPL_NOW_MS;
+	} else if (len == 3 && !strncmp (name, "key", 3)) {
+		part->type = TMPL_KEY;
+	} else if (len > 5 && len - 5 < sizeof (range) && !strncmp (name, "rand:", 5)) {
+		memcpy (range, name + 5, len - 5);
+		range[len - 5] = '\0';
+
+		if (sscanf (range, "%llu-%llu%n", &low, &high, &n) != 2 ||
+				(size_t) n != len - 5 || low > high) {
+			return -1;
+		}
+
+		part->type = TMPL_RAND;
+		part->low = low;
+		part->high = high;
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Renders a random version 4 UUID
+*
+* Input  -      *p   - where to render, room for TMPL_UUID_LEN bytes
+*               *rng - the generator of the worker
+* Return -      The end of the rendered UUID
+*/
+static char* render_uuid (char* p, rng_state* rng)
+{
+	static const char hex[] = "0123456789abcdef";
+	unsigned char b[16];
+	uint64_t r0 = rng_next (rng);
+	uint64_t r1 = rng_next (rng);
+	int i;
+
+	memcpy (b, &r0, 8);
+	memcpy (b + 8, &r1, 8);
+
+	b[6] = (b[6] & 0x0f) | 0x40;    /* version 4 */
+	b[8] = (b[8] & 0x3f) | 0x80;    /* variant 10 */
+
+	for (i = 0; i < 16; i++) {
+		if (i == 4 || i == 6 || i == 8 || i == 10) {
+			*p++ = '-';
+		}
+		*p++ = hex[b[i] >> 4];
+		*p++ = hex[b[i] & 0x0f];
+	}
+
+	return p;
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,92 @@
+/*
+ *     tmpl.h
+ *
+ */
+#ifndef TMPL_H
+#define TMPL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "rng.h"
+
+/* Flags of tmpl_compile () */
+#define TMPL_STRICT 0x1     /* an unknown {{placeholder}} is an error */
+#define TMPL_COPY   0x2     /* the template keeps a copy of the string */
+
+/* Parts of a template */
+typedef enum tmpl_part_type {
+	TMPL_LITERAL = 0,       /* text, copied as it is */
+	TMPL_SEQ,               /* {{seq}}, number of the try in its worker */
+	TMPL_RAND,              /* {{rand:<low>-<high>}}, uniform integer */
+	TMPL_UUID,              /* {{uuid}}, random version 4 UUID */
+	TMPL_WORKER,            /* {{worker}}, index of the worker */
+	TMPL_NOW_MS,            /* {{now_ms}}, wall clock, msec since the epoch */
+	TMPL_KEY,               /* {{key}}, key of the try drawn from the KEYSPACE */
+} tmpl_part_type;
+
+/* A part of a template */
+typedef struct tmpl_part {
+
+	tmpl_part_type type;
+
+	/* Text of a literal, pointing into the string of the template */
+	const char* text;
+	size_t len;
+
+	/* Range of {{rand}} */
+	uint64_t low;
+	uint64_t high;
+
+} tmpl_part;
+
+/* A string with placeholders, compiled once when the config is read */
+typedef struct tmpl {
+
+	/* The parts, NULL when the string has no placeholders */
+	tmpl_part* parts;
+	int parts_num;
+
+	/* Longest rendering of the template, without the terminating zero */
+	size_t max_len;
+
+	/* Copy of the string, when compiled with TMPL_COPY */
+	char* copy;
+
+} tmpl;
+
+/* Values of the placeholders for a try */
+typedef struct tmpl_vars {
+
+	/* Number of the try in its worker */
+	long long seq;
+
+	/* Index of the worker */
+	int worker;
+
+	/* Rank of the key of the try, 0 without a keyspace */
+	uint64_t key;
+
+	/* Generator of the worker, for {{rand}} and {{uuid}} */
+	rng_state* rng;
+
+} tmpl_vars;
+
+/* Compiles the string of <len> bytes */
+int tmpl_compile (tmpl* t, const char* str, size_t len, int flags);
+
+/* Releases a template */
+void tmpl_free (tmpl* t);
+
+/* Tells, whether the template has placeholders to render per try */
+int tmpl_dynamic (const tmpl* t);
+
+/* Tells, whether the template has a placeholder of the type */
+int tmpl_uses (const tmpl* t, tmpl_part_type type);
+
+/* Renders the template into the arena, a zero terminated string */
+char* tmpl_render (const tmpl* t, const tmpl_vars* vars, arena* a, size_t* len);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
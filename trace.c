@@ -0,0 +1,518 @@
+/*
+ *     trace.c
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "conf.h"
+#include "trace.h"
+
+/* Varints of a record beyond the phases: worker, send time, connects,
+   status, CURLcode, bad body flag, url id and the ip length */
+#define TRACE_FIELDS_MORE 8
+
+/* Longest encoding of a record: the varints of up to 10 bytes and the ip */
+#define TRACE_RECORD_MAX ((PHASE_NUM + TRACE_FIELDS_MORE) * 10 + \
+		sizeof (((client_stats *) 0)->server_ip))
+
+/* Each phase is encoded as a delta to an earlier phase, that it is usually
+   close to, -1 for none. The bases precede the phases in stat_phase.  */
+static const int delta_base [PHASE_NUM] = {
+	-1,                     /* PHASE_TOTAL */
+	-1,                     /* PHASE_NAMELOOKUP */
+	PHASE_NAMELOOKUP,       /* PHASE_CONNECT */
+	-1,                     /* PHASE_APPCONNECT, zero without TLS */
+	PHASE_CONNECT,          /* PHASE_PRETRANSFER */
+	PHASE_PRETRANSFER,      /* PHASE_START_TRANSFER */
+	-1,                     /* PHASE_REDIRECT */
+	PHASE_TOTAL,            /* PHASE_RESPONSE */
+	-1,                     /* PHASE_REDIRECT_COUNT */
+	-1,                     /* PHASE_SIZE_UPLOAD */
+	-1,                     /* PHASE_SIZE_DOWNLOAD */
+	-1,                     /* PHASE_SPEED_UPLOAD */
+	-1,                     /* PHASE_SPEED_DOWNLOAD */
+	-1,                     /* PHASE_HEADER_SIZE */
+	-1,                     /* PHASE_SETUP */
+};
+
+/* forward declaration */
+static void* writer_run (void* arg);
+static int drain_ring (trace_writer* tw, int ring_id);
+static size_t encode_record (unsigned char* buf, int ring_id, trace_ring* ring,
+		const client_stats* st);
+static int decode_record (FILE* fp, int* ring_id, long long* last_send_times,
+		int last_num, client_stats* st);
+static size_t put_varint (unsigned char* buf, uint64_t v);
+static int get_varint (FILE* fp, uint64_t* v);
+static uint64_t zigzag (long long v);
+static long long unzigzag (uint64_t v);
+
+
+/*
+* Description - Opens <run-name>.trace, writes the file header and starts
+*               the writer thread. The workers push into a ring each, the
+*               writer encodes the records and writes them in large blocks,
+*               so that tracing does not slow the workers down.
+*
+* Input  -      *tw       - the writer to start
+*               *run_name - name of the run, "samk" when empty
+*               rings_num - number of the workers
+* Return -      On Success - 0, on Error -1
+*/
+int trace_writer_start (trace_writer* tw, const char* run_name, int rings_num)
+{
+	int i, err;
+
+	memset (tw, 0, sizeof (trace_writer));
+	atomic_init (&tw->stop, 0);
+
+	snprintf (tw->filename, sizeof (tw->filename), "%s.trace",
+			run_name && run_name[0] ? run_name : "samk");
+
+	if (!(tw->rings = (trace_ring *) calloc (rings_num, sizeof (trace_ring)))) {
+		fprintf (stderr, "%s - error: allocation of %d trace rings failed.\n",
+				__func__, rings_num);
+		return -1;
+	}
+	tw->rings_num = rings_num;
+
+	for (i = 0; i < rings_num; i++) {
+		if (!(tw->rings[i].records = (client_stats *) calloc (TRACE_RING_SIZE,
+						sizeof (client_stats)))) {
+			fprintf (stderr, "%s - error: allocation of trace ring %d failed.\n",
+					__func__, i);
+			goto fail;
+		}
+		atomic_init (&tw->rings[i].head, 0);
+		atomic_init (&tw->rings[i].tail, 0);
+	}
+
+	if (!(tw->fp = fopen (tw->filename, "wb"))) {
+		fprintf (stderr, "%s - error: fopen() failed to open for writing \"%s\", errno %d.\n",
+				__func__, tw->filename, errno);
+		goto fail;
+	}
+
+	setvbuf (tw->fp, NULL, _IOFBF, TRACE_FILE_BUFFER);
+
+	fwrite (TRACE_MAGIC, 1, sizeof (TRACE_MAGIC) - 1, tw->fp);
+	fputc (TRACE_VERSION, tw->fp);
+	fputc (PHASE_NUM, tw->fp);
+
+	if ((err = pthread_create (&tw->thread, NULL, writer_run, tw))) {
+		fprintf (stderr, "%s - error: pthread_create () failed, errno %d.\n",
+				__func__, err);
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	if (tw->fp) {
+		fclose (tw->fp);
+	}
+	for (i = 0; i < rings_num; i++) {
+		free (tw->rings[i].records);
+	}
+	free (tw->rings);
+	memset (tw, 0, sizeof (trace_writer));
+
+	return -1;
+}
+
+
+/*
+* Description - Stops the writer, when the workers are done. The records
+*               left in the rings are written before the file is closed.
+*
+* Input  -      *tw - the started writer
+* Return -      On Success - 0, on Error -1
+*/
+int trace_writer_stop (trace_writer* tw)
+{
+	unsigned long dropped = 0;
+	int ret = 0;
+	int i;
+
+	atomic_store (&tw->stop, 1);
+	pthread_join (tw->thread, NULL);
+
+	for (i = 0; i < tw->rings_num; i++) {
+		dropped += tw->rings[i].dropped;
+		free (tw->rings[i].records);
+	}
+
+	if (fclose (tw->fp) != 0) {
+		fprintf (stderr, "%s - error: writing \"%s\" failed, errno %d.\n",
+				__func__, tw->filename, errno);
+		ret = -1;
+	}
+
+	if (dropped) {
+		fprintf (stderr, "%s - warning: %lu tries are not traced, the writer fell behind.\n",
+				__func__, dropped);
+	}
+
+	free (tw->rings);
+	tw->rings = NULL;
+
+	return ret;
+}
+
+
+/*
+* Description - Appends the results of a try to the ring. Called by the worker
+*               on each completed try; copies the record, never blocks.
+*
+* Input  -      *ring - ring of the worker
+*               *st   - the results of the try
+*/
+void trace_ring_push (trace_ring* ring, const client_stats* st)
+{
+	unsigned long head = atomic_load_explicit (&ring->head, memory_order_relaxed);
+	unsigned long tail = atomic_load_explicit (&ring->tail, memory_order_acquire);
+
+	if (head - tail >= TRACE_RING_SIZE) {
+		ring->dropped++;
+		return;
+	}
+
+	ring->records[head & (TRACE_RING_SIZE - 1)] = *st;
+
+	atomic_store_explicit (&ring->head, head + 1, memory_order_release);
+}
+
+
+/*
+* Description - Converts a trace file to CSV with a header line, or to JSON
+*               lines, an object per try.
+*
+* Input  -      *filename - the trace file
+*               format    - TRACE_FORMAT_CSV or TRACE_FORMAT_JSON
+*               *out      - the stream to write to
+* Return -      On Success - 0, on Error -1
+*/
+int trace_dump (const char* filename, trace_format format, FILE* out)
+{
+	char magic[sizeof (TRACE_MAGIC)];
+	long long* last_send_times = NULL;
+	int last_num = 0;
+	client_stats st;
+	int ring_id;
+	int version;
+	int i;
+	int ret = -1;
+	FILE* fp;
+
+	if (!(fp = fopen (filename, "rb"))) {
+		fprintf (stderr, "%s - error: fopen() failed to open \"%s\", errno %d.\n",
+				__func__, filename, errno);
+		return -1;
+	}
+
+	if (fread (magic, 1, sizeof (TRACE_MAGIC) - 1, fp) != sizeof (TRACE_MAGIC) - 1 ||
+			memcmp (magic, TRACE_MAGIC, sizeof (TRACE_MAGIC) - 1) ||
+			(version = fgetc (fp)) != TRACE_VERSION ||
+			fgetc (fp) != PHASE_NUM) {
+		fprintf (stderr, "%s - error: \"%s\" is not a trace file of version %d.\n",
+				__func__, filename, TRACE_VERSION);
+		goto out;
+	}
+
+	if (!(last_send_times = (long long *) calloc (WORKERS_MAX_NUM, sizeof (long long)))) {
+		fprintf (stderr, "%s - error: allocation failed.\n", __func__);
+		goto out;
+	}
+	last_num = WORKERS_MAX_NUM;
+
+	if (format == TRACE_FORMAT_CSV) {
+		fprintf (out, "worker,send_time");
+		for (i = 0; i < PHASE_NUM; i++) {
+			fprintf (out, ",%s", stats_phase_key (i));
+		}
+		fprintf (out, ",num_connects,resp_code,curl_code,bad_body,url_id,server_ip\n");
+	}
+
+	while (1) {
+		int res = decode_record (fp, &ring_id, last_send_times, last_num, &st);
+
+		if (res == 0) {
+			break;
+		} else if (res == -1) {
+			fprintf (stderr, "%s - error: \"%s\" is truncated or corrupt.\n",
+					__func__, filename);
+			goto out;
+		}
+
+		if (format == TRACE_FORMAT_CSV) {
+			fprintf (out, "%d,%lld", ring_id, st.send_time);
+			for (i = 0; i < PHASE_NUM; i++) {
+				fprintf (out, ",%lld", stats_phase_value (&st, i));
+			}
+			fprintf (out, ",%ld,%ld,%ld,%d,%d,%s\n", st.num_connects, st.resp_code,
+					st.curl_code, st.bad_body, st.url_id, st.server_ip);
+		} else {
+			fprintf (out, "{\"worker\":%d,\"send_time\":%lld", ring_id, st.send_time);
+			for (i = 0; i < PHASE_NUM; i++) {
+				fprintf (out, ",\"%s\":%lld", stats_phase_key (i), stats_phase_value (&st, i));
+			}
+			fprintf (out, ",\"num_connects\":%ld,\"resp_code\":%ld,\"curl_code\":%ld,"
+					"\"bad_body\":%d,\"url_id\":%d,\"server_ip\":\"%s\"}\n",
+					st.num_connects, st.resp_code, st.curl_code, st.bad_body,
+					st.url_id, st.server_ip);
+		}
+	}
+
+	ret = 0;
+
+out:
+	free (last_send_times);
+	fclose (fp);
+
+	return ret;
+}
+
+
+/*
+* Description - Thread function of the writer. Drains the rings, sleeps when
+*               all of them are empty, exits when stopped and drained.
+*
+* Input  -      *arg - the writer
+* Return -      NULL
+*/
+static void* writer_run (void* arg)
+{
+	trace_writer* tw = (trace_writer *) arg;
+	struct timespec idle = { 0, TRACE_IDLE_USEC * 1000 };
+	int popped;
+	int stop;
+	int i;
+
+	while (1) {
+		/* read before draining, the records pushed before the stop are
+		   then surely seen */
+		stop = atomic_load (&tw->stop);
+		popped = 0;
+
+		for (i = 0; i < tw->rings_num; i++) {
+			popped += drain_ring (tw, i);
+		}
+
+		if (!popped) {
+			if (stop) {
+				break;
+			}
+			nanosleep (&idle, NULL);
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+* Description - Encodes and writes all the records of a ring
+*
+* Input  -      *tw     - the writer
+*               ring_id - index of the ring, the worker id
+* Return -      Number of the records written
+*/
+static int drain_ring (trace_writer* tw, int ring_id)
+{
+	trace_ring* ring = &tw->rings[ring_id];
+	unsigned long tail = atomic_load_explicit (&ring->tail, memory_order_relaxed);
+	unsigned long head = atomic_load_explicit (&ring->head, memory_order_acquire);
+	unsigned char buf[TRACE_RECORD_MAX];
+	int popped = 0;
+
+	while (tail != head) {
+		size_t len = encode_record (buf, ring_id, ring,
+				&ring->records[tail & (TRACE_RING_SIZE - 1)]);
+
+		fwrite (buf, 1, len, tw->fp);
+		tail++;
+		popped++;
+	}
+
+	atomic_store_explicit (&ring->tail, tail, memory_order_release);
+	tw->written += popped;
+
+	return popped;
+}
+
+
+/*
+* Description - Encodes a record. All the fields are varints. The send time
+*               is a delta to the previous record of the same worker, the
+*               timing phases deltas to the phases they follow (delta_base),
+*               so that most of the fields take a byte or two.
+*
+* Input  -      *buf    - TRACE_RECORD_MAX bytes
+*               ring_id - the worker id
+*               *ring   - ring of the worker, keeps the delta base
+*               *st     - the results of the try
+* Return -      Length of the encoded record
+*/
+static size_t encode_record (unsigned char* buf, int ring_id, trace_ring* ring,
+		const client_stats* st)
+{
+	size_t len = 0;
+	size_t ip_len = strnlen (st->server_ip, sizeof (st->server_ip) - 1);
+	int i;
+
+	len += put_varint (buf + len, (uint64_t) ring_id);
+	len += put_varint (buf + len, zigzag (st->send_time - ring->last_send_time));
+	ring->last_send_time = st->send_time;
+
+	for (i = 0; i < PHASE_NUM; i++) {
+		long long base = delta_base[i] < 0 ? 0 : stats_phase_value (st, delta_base[i]);
+
+		len += put_varint (buf + len, zigzag (stats_phase_value (st, i) - base));
+	}
+
+	len += put_varint (buf + len, (uint64_t) st->num_connects);
+	len += put_varint (buf + len, (uint64_t) st->resp_code);
+	len += put_varint (buf + len, (uint64_t) st->curl_code);
+	len += put_varint (buf + len, (uint64_t) st->bad_body);
+	len += put_varint (buf + len, (uint64_t) st->url_id);
+
+	buf[len++] = (unsigned char) ip_len;
+	memcpy (buf + len, st->server_ip, ip_len);
+	len += ip_len;
+
+	return len;
+}
+
+
+/*
+* Description - Decodes the next record of a trace file
+*
+* Input  -      *fp              - the trace file, past the header
+*               *last_send_times - delta bases, per worker
+*               last_num         - number of the delta bases
+* Output -      *ring_id         - the worker id
+*               *st              - the results of the try
+* Return -      1 for a record, 0 at the end of the file, -1 on Error
+*/
+static int decode_record (FILE* fp, int* ring_id, long long* last_send_times,
+		int last_num, client_stats* st)
+{
+	uint64_t v[PHASE_NUM + TRACE_FIELDS_MORE];
+	uint64_t* more = v + 2 + PHASE_NUM;
+	int ip_len;
+	int c, i;
+
+	if ((c = fgetc (fp)) == EOF) {
+		return 0;
+	}
+	ungetc (c, fp);
+
+	for (i = 0; i < PHASE_NUM + TRACE_FIELDS_MORE; i++) {
+		if (get_varint (fp, &v[i]) == -1) {
+			return -1;
+		}
+	}
+
+	if (v[0] >= (uint64_t) last_num) {
+		return -1;
+	}
+
+	memset (st, 0, sizeof (client_stats));
+
+	*ring_id = (int) v[0];
+	st->send_time = last_send_times[*ring_id] + unzigzag (v[1]);
+	last_send_times[*ring_id] = st->send_time;
+
+	/* the bases precede the phases, they are decoded already */
+	for (i = 0; i < PHASE_NUM; i++) {
+		long long base = delta_base[i] < 0 ? 0 : stats_phase_value (st, delta_base[i]);
+
+		stats_phase_set (st, i, base + unzigzag (v[2 + i]));
+	}
+
+	st->num_connects = (long) more[0];
+	st->resp_code = (long) more[1];
+	st->curl_code = (long) more[2];
+	st->bad_body = (int) more[3];
+	st->url_id = (int) more[4];
+
+	ip_len = (int) more[5];
+
+	if (ip_len >= (int) sizeof (st->server_ip) ||
+			fread (st->server_ip, 1, ip_len, fp) != (size_t) ip_len) {
+		return -1;
+	}
+	st->server_ip[ip_len] = 0;
+
+	return 1;
+}
+
+
+/*
+* Description - LEB128 encoding of an unsigned value, 7 bits per byte
+*
+* Input  -      *buf - at least 10 bytes
+*               v    - the value
+* Return -      Number of the bytes written
+*/
+static size_t put_varint (unsigned char* buf, uint64_t v)
+{
+	size_t len = 0;
+
+	while (v >= 0x80) {
+		buf[len++] = (unsigned char) (v | 0x80);
+		v >>= 7;
+	}
+	buf[len++] = (unsigned char) v;
+
+	return len;
+}
+
+
+/*
+* Description - Reads a LEB128 encoded value
+*
+* Input  -      *fp - the stream
+* Output -      *v  - the value
+* Return -      On Success - 0, on Error -1
+*/
+static int get_varint (FILE* fp, uint64_t* v)
+{
+	int shift = 0;
+	int c;
+
+	*v = 0;
+
+	while ((c = fgetc (fp)) != EOF && shift < 64) {
+		*v |= (uint64_t) (c & 0x7f) << shift;
+
+		if (!(c & 0x80)) {
+			return 0;
+		}
+		shift += 7;
+	}
+
+	return -1;
+}
+
+
+/* Maps signed values to unsigned ones, small magnitudes to small values */
+static uint64_t zigzag (long long v)
+{
+	return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+
+static long long unzigzag (uint64_t v)
+{
+	return (long long) (v >> 1) ^ -(long long) (v & 1);
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
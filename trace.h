@@ -0,0 +1,89 @@
+/*
+ *     trace.h
+ *
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "conf.h"
+
+/* Records, a worker may get ahead of the writer by. Power of two.  */
+#define TRACE_RING_SIZE 16384
+
+/* stdio buffer of the trace file */
+#define TRACE_FILE_BUFFER (1 << 20)
+
+/* Sleep of the writer thread, when all the rings are empty */
+#define TRACE_IDLE_USEC 1000
+
+/* First bytes of a trace file, the last one is the format version */
+#define TRACE_MAGIC "SAMKTRC"
+#define TRACE_VERSION 3
+
+/* Output formats of trace_dump () */
+typedef enum trace_format {
+	TRACE_FORMAT_CSV = 0,
+	TRACE_FORMAT_JSON,
+} trace_format;
+
+/* Single producer, single consumer ring of the results of the tries. The
+   worker pushes, the writer thread pops; neither of them ever waits, a
+   try, that finds the ring full, is counted as dropped.  */
+typedef struct trace_ring {
+
+	/* TRACE_RING_SIZE records */
+	client_stats* records;
+
+	/* Next record to push, written by the worker only */
+	_Alignas (64) atomic_ulong head;
+
+	/* Next record to pop, written by the writer only */
+	_Alignas (64) atomic_ulong tail;
+
+	/* Tries not traced, since the ring was full. Worker only.  */
+	unsigned long dropped;
+
+	/* Send time of the last popped record, the base of the delta. Writer only.  */
+	long long last_send_time;
+
+} trace_ring;
+
+/* The writer thread, encoding the records of all the rings to the trace file */
+typedef struct trace_writer {
+
+	/* The trace file */
+	FILE* fp;
+	char filename[RUN_NAME_SIZE + 16];
+
+	/* Ring per worker */
+	trace_ring* rings;
+	int rings_num;
+
+	/* Number of the records written */
+	unsigned long long written;
+
+	/* Set to let the writer drain the rings and exit */
+	atomic_int stop;
+
+	pthread_t thread;
+
+} trace_writer;
+
+/* Opens <run-name>.trace and starts the writer thread with <rings_num> rings */
+int trace_writer_start (trace_writer* tw, const char* run_name, int rings_num);
+
+/* Lets the writer drain the rings, joins it and closes the file */
+int trace_writer_stop (trace_writer* tw);
+
+/* Appends the results of a try to the ring, never blocks */
+void trace_ring_push (trace_ring* ring, const client_stats* st);
+
+/* Converts a trace file to CSV or JSON lines */
+int trace_dump (const char* filename, trace_format format, FILE* out);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
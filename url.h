@@ -5,8 +5,15 @@
 #ifndef URL_H
 #define URL_H
 
+#include "header.h"
+#include "tmpl.h"
+
 #define CUSTOM_HDRS_MAX_NUM 1024 
 
+struct validate_spec;
+struct payload;
+struct curl_slist;
+
 /* Application types of URLs.  */
 typedef enum url_type_t {
 	URL_UNDEF = 0, 
@@ -18,6 +25,21 @@ typedef enum url_type_t {
 	URL_TELNET,
 } url_type;
 
+/* How the names of a url are resolved to addresses.  */
+typedef enum dns_mode {
+	/* Not configured; cached with SHARE_CACHES, cold otherwise */
+	DNS_MODE_DEFAULT = 0,
+	/* Looked up by every new connection, nothing is cached */
+	DNS_MODE_COLD,
+	/* Looked up once per DNS_CACHE_TTL by the cache of the handle, or
+	   the one of the run with SHARE_CACHES */
+	DNS_MODE_CACHED,
+	/* Never looked up, the addresses of the RESOLVE tags are used */
+	DNS_MODE_PINNED,
+
+	DNS_MODES_NUM,
+} dns_mode;
+
 
 /* A structure, that contains all the knowledge about the url to fetch */
 typedef struct url_context {
@@ -28,12 +50,24 @@ typedef struct url_context {
 	/* URL buffer length*/
 	size_t url_str_len;
 
+	/* Placeholders of the url, rendered per try when there are any */
+	tmpl url_tmpl;
+
 	/* Number of custom  HTTP headers */
 	int custom_http_hdrs_num;
 
-	/* The list of custom  HTTP headers */
+	/* The list of custom  HTTP headers, as parsed. Built into <headers>
+	   and released, once the config is read.  */
 	struct curl_slist *custom_http_hdrs;
 
+	/* The custom HTTP headers without placeholders, sent by reference
+	   with each try */
+	header_set headers;
+
+	/* The custom HTTP headers with placeholders, rendered per try */
+	tmpl* header_tmpls;
+	int header_tmpls_num;
+
 	/* Request type/method used for http */
 	size_t req_type;
 
@@ -44,6 +78,19 @@ typedef struct url_context {
 	/* Maximum time to establish TCP connection with a server (including resolving) */
 	long connect_timeout;
 
+	/* HTTP version to ask for, CURL_HTTP_VERSION_NONE for the libcurl default */
+	long http_version;
+
+	/* How the names of the url are resolved */
+	dns_mode dns_mode;
+
+	/* The host:port:addr entries of the RESOLVE tags, NULL for none */
+	struct curl_slist* resolve;
+
+	/* Address family of the connections, CURL_IPRESOLVE_*; any of them
+	   races IPv6 and IPv4 (happy eyeballs)  */
+	long ip_resolve;
+
 	/* Logs headers of HTTP responses to files, when true. */
 	int log_resp_headers;
 
@@ -53,9 +100,18 @@ typedef struct url_context {
 	/* Application type of url, e.g. HTTP, HTTPS, FTP, etc */
 	url_type urltype;
 
-	/* Directory name to be used for logfiles of responses 
-	   (headers and bodies).  */
-	char* dir_log;
+	/* Index of the url in the workload */
+	int id;
+
+	/* Relative share of the tries fetching this url */
+	double weight;
+
+	/* Expected content of the response bodies, NULL when not validated */
+	struct validate_spec* validate;
+
+	/* Request bodies of POST and PUT, taken in turn by the tries */
+	struct payload* payloads;
+	int payloads_num;
 
 } url_context;
 
@@ -0,0 +1,369 @@
+/*
+ *     validate.c
+ *
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "validate.h"
+
+/* Reflected CRC32C polynomial */
+#define CRC32C_POLY 0x82f63b78
+
+/* forward declaration */
+static void crc32c_init (void);
+static uint32_t crc32c_sw (uint32_t crc, const unsigned char* p, size_t len);
+#if defined(__x86_64__)
+static uint32_t crc32c_hw (uint32_t crc, const unsigned char* p, size_t len);
+#endif
+
+/* Slice-by-8 tables of the software CRC32C */
+static uint32_t crc32c_table[8][256];
+
+/* CRC32C kernel of the cpu, chosen once */
+static uint32_t (*crc32c_kernel) (uint32_t crc, const unsigned char* p, size_t len);
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+
+/*
+* Description - Allocates the expectations of a url, nothing is checked
+*               until the fields are set
+*
+* Return -      On Success - the expectations, on Error NULL
+*/
+validate_spec* validate_spec_new (void)
+{
+	validate_spec* spec;
+
+	if (!(spec = (validate_spec *) calloc (1, sizeof (validate_spec)))) {
+		fprintf (stderr, "%s - error: allocation failed.\n", __func__);
+		return NULL;
+	}
+
+	spec->length = -1;
+	spec->window = VALIDATE_WINDOW_DEFAULT;
+	atomic_init (&spec->reported, 0);
+
+	pthread_once (&crc32c_once, crc32c_init);
+
+	return spec;
+}
+
+
+/*
+* Description - Releases the expectations of a url
+*
+* Input  -      *spec - the expectations, may be NULL
+*/
+void validate_spec_free (validate_spec* spec)
+{
+	if (spec) {
+		if (spec->check_regex) {
+			regfree (&spec->regex);
+		}
+		free (spec);
+	}
+}
+
+
+/*
+* Description - Releases the regex window of a handle
+*
+* Input  -      *vs - validation state of a handle
+*/
+void validate_state_free (validate_state* vs)
+{
+	free (vs->window);
+	memset (vs, 0, sizeof (validate_state));
+}
+
+
+/*
+* Description - Starts the body of a try. The regex window of the handle is
+*               allocated on the first try of a url with a regex to match, the
+*               window is kept for the later tries.
+*
+* Input  -      *vs   - validation state of a handle
+*               *spec - the expectations of the url of the try, NULL for none
+* Return -      On Success - 0, on Error -1
+*/
+int validate_begin (validate_state* vs, validate_spec* spec)
+{
+	char* window;
+
+	vs->spec = spec;
+
+	if (spec && spec->check_regex && spec->window > vs->window_size) {
+
+		if (!(window = (char *) realloc (vs->window, spec->window + 1))) {
+			fprintf (stderr, "%s - error: allocation of %zu bytes failed.\n",
+					__func__, spec->window + 1);
+			return -1;
+		}
+
+		vs->window = window;
+		vs->window_size = spec->window;
+	}
+
+	vs->length = 0;
+	vs->crc = 0;
+	vs->found = 0;
+	vs->tail_len = 0;
+	vs->window_len = 0;
+
+	return 0;
+}
+
+
+/*
+* Description - Checks a chunk of the body as it arrives, nothing of the
+*               body is kept except the regex window. The CRC runs on the
+*               crc32 instruction of SSE4.2, when there is one; the string
+*               is searched by memmem () of the C library, that is vectorized.
+*
+* Input  -      *vs   - validation state of a handle
+*               *data - the chunk
+*               len   - length of the chunk
+*/
+void validate_update (validate_state* vs, const void* data, size_t len)
+{
+	const validate_spec* spec = vs->spec;
+
+	if (!spec) {
+		return;
+	}
+
+	vs->length += len;
+
+	if (spec->check_crc) {
+		vs->crc = ~crc32c_kernel (~vs->crc, (const unsigned char *) data, len);
+	}
+
+	if (spec->contains_len && !vs->found) {
+		size_t keep = spec->contains_len - 1;
+
+		/* the string may start in the tail of the previous chunk */
+		if (vs->tail_len) {
+			char joint[2 * VALIDATE_CONTAINS_MAX];
+			size_t head = len < keep ? len : keep;
+
+			memcpy (joint, vs->tail, vs->tail_len);
+			memcpy (joint + vs->tail_len, data, head);
+
+			if (memmem (joint, vs->tail_len + head, spec->contains, spec->contains_len)) {
+				vs->found = 1;
+			}
+		}
+
+		if (!vs->found && memmem (data, len, spec->contains, spec->contains_len)) {
+			vs->found = 1;
+		}
+
+		if (!vs->found && keep) {
+			/* keep the last <keep> bytes of the body seen so far */
+			if (len >= keep) {
+				memcpy (vs->tail, (const char *) data + len - keep, keep);
+				vs->tail_len = keep;
+			} else {
+				size_t drop = vs->tail_len + len > keep ? vs->tail_len + len - keep : 0;
+
+				memmove (vs->tail, vs->tail + drop, vs->tail_len - drop);
+				memcpy (vs->tail + vs->tail_len - drop, data, len);
+				vs->tail_len += len - drop;
+			}
+		}
+	}
+
+	if (spec->check_regex && vs->window_len < spec->window) {
+		size_t copy = spec->window - vs->window_len;
+
+		if (copy > len) {
+			copy = len;
+		}
+
+		memcpy (vs->window + vs->window_len, data, copy);
+		vs->window_len += copy;
+	}
+}
+
+
+/*
+* Description - Ends the body of a try and checks the expectations, that need
+*               the whole body. The first bad body of the run is described on
+*               stderr, to help setting the expectations right.
+*
+* Input  -      *vs - validation state of a handle
+* Return -      1 when the body is as expected or not validated, 0 otherwise
+*/
+int validate_end (validate_state* vs)
+{
+	validate_spec* spec = vs->spec;
+	int ok = 1;
+
+	if (!spec) {
+		return 1;
+	}
+
+	if (spec->length >= 0 && vs->length != spec->length) {
+		ok = 0;
+	}
+
+	if (spec->check_crc && vs->crc != spec->crc32c) {
+		ok = 0;
+	}
+
+	if (spec->contains_len && !vs->found) {
+		ok = 0;
+	}
+
+	if (spec->check_regex) {
+		vs->window[vs->window_len] = 0;
+
+		if (regexec (&spec->regex, vs->window, 0, NULL, 0) != 0) {
+			ok = 0;
+		}
+	}
+
+	if (!ok && !atomic_exchange (&spec->reported, 1)) {
+		fprintf (stderr, "%s - warning: unexpected body of %lld bytes", __func__, vs->length);
+
+		if (spec->check_crc) {
+			fprintf (stderr, ", crc32c %08x", vs->crc);
+		}
+
+		fprintf (stderr, "%s.\n", spec->contains_len && !vs->found ?
+				", the string is missing" : "");
+	}
+
+	return ok;
+}
+
+
+/*
+* Description - CRC32C (Castagnoli) of a buffer
+*
+* Input  -      crc   - CRC of the preceding data, 0 at the start
+*               *data - the buffer
+*               len   - length of the buffer
+* Return -      The CRC
+*/
+uint32_t crc32c (uint32_t crc, const void* data, size_t len)
+{
+	pthread_once (&crc32c_once, crc32c_init);
+
+	return ~crc32c_kernel (~crc, (const unsigned char *) data, len);
+}
+
+
+/*
+* Description - Builds the software tables and picks the kernel of the cpu
+*/
+static void crc32c_init (void)
+{
+	uint32_t crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = (uint32_t) i;
+		for (j = 0; j < 8; j++) {
+			crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+		}
+		crc32c_table[0][i] = crc;
+	}
+
+	for (i = 0; i < 256; i++) {
+		crc = crc32c_table[0][i];
+		for (j = 1; j < 8; j++) {
+			crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+			crc32c_table[j][i] = crc;
+		}
+	}
+
+	crc32c_kernel = crc32c_sw;
+
+#if defined(__x86_64__)
+	if (__builtin_cpu_supports ("sse4.2")) {
+		crc32c_kernel = crc32c_hw;
+	}
+#endif
+}
+
+
+/*
+* Description - Slice-by-8 CRC32C, 8 bytes per step. No pre and post
+*               inversion, the callers do it.
+*/
+static uint32_t crc32c_sw (uint32_t crc, const unsigned char* p, size_t len)
+{
+	while (len && ((uintptr_t) p & 7)) {
+		crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+
+	while (len >= 8) {
+		uint64_t v;
+
+		memcpy (&v, p, 8);
+		v ^= crc;
+
+		crc = crc32c_table[7][v & 0xff] ^
+			crc32c_table[6][(v >> 8) & 0xff] ^
+			crc32c_table[5][(v >> 16) & 0xff] ^
+			crc32c_table[4][(v >> 24) & 0xff] ^
+			crc32c_table[3][(v >> 32) & 0xff] ^
+			crc32c_table[2][(v >> 40) & 0xff] ^
+			crc32c_table[1][(v >> 48) & 0xff] ^
+			crc32c_table[0][v >> 56];
+
+		p += 8;
+		len -= 8;
+	}
+
+	while (len--) {
+		crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+
+#if defined(__x86_64__)
+/*
+* Description - CRC32C on the crc32 instruction of SSE4.2, 8 bytes per step.
+*               No pre and post inversion, the callers do it.
+*/
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw (uint32_t crc, const unsigned char* p, size_t len)
+{
+	uint64_t crc64 = crc;
+
+	while (len && ((uintptr_t) p & 7)) {
+		crc64 = _mm_crc32_u8 ((uint32_t) crc64, *p++);
+		len--;
+	}
+
+	while (len >= 8) {
+		uint64_t v;
+
+		memcpy (&v, p, 8);
+		crc64 = _mm_crc32_u64 (crc64, v);
+		p += 8;
+		len -= 8;
+	}
+
+	while (len--) {
+		crc64 = _mm_crc32_u8 ((uint32_t) crc64, *p++);
+	}
+
+	return (uint32_t) crc64;
+}
+#endif
+
+/* vim: set ts=4 sw=4 et sts=4:  */
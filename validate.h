@@ -0,0 +1,93 @@
+/*
+ *     validate.h
+ *
+ */
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <regex.h>
+
+/* Longest EXPECT_CONTAINS string */
+#define VALIDATE_CONTAINS_MAX 256
+
+/* Default number of the first body bytes EXPECT_REGEX is matched against */
+#define VALIDATE_WINDOW_DEFAULT 4096
+
+/* Expected content of the response bodies of a url */
+typedef struct validate_spec {
+
+	/* Expected body length, -1 when not checked */
+	long long length;
+
+	/* Flag; whether the CRC32C of the body is checked, and its value */
+	int check_crc;
+	uint32_t crc32c;
+
+	/* A string the body is to contain, empty when not checked */
+	char contains[VALIDATE_CONTAINS_MAX + 1];
+	size_t contains_len;
+
+	/* A regular expression the beginning of the body is to match */
+	int check_regex;
+	regex_t regex;
+
+	/* Number of the first body bytes the regex is matched against */
+	size_t window;
+
+	/* Set, when the first bad body of the run has been described */
+	atomic_int reported;
+
+} validate_spec;
+
+/* State of the validation of the body of a try, kept per handle */
+typedef struct validate_state {
+
+	/* The expectations of the current try, NULL when not validated */
+	validate_spec* spec;
+
+	/* Body bytes received so far */
+	long long length;
+
+	/* Running CRC32C of the body */
+	uint32_t crc;
+
+	/* Flag; whether the EXPECT_CONTAINS string has been seen */
+	int found;
+
+	/* Last bytes of the previous chunk, for a string split by chunks */
+	char tail[VALIDATE_CONTAINS_MAX];
+	size_t tail_len;
+
+	/* Beginning of the body, for the regex, <window_size> + 1 bytes */
+	char* window;
+	size_t window_len;
+	size_t window_size;
+
+} validate_state;
+
+/* Allocates the expectations with nothing to check */
+validate_spec* validate_spec_new (void);
+
+/* Releases the expectations */
+void validate_spec_free (validate_spec* spec);
+
+/* Releases the per handle buffers */
+void validate_state_free (validate_state* vs);
+
+/* Starts the body of a try of a url with the expectations <spec> */
+int validate_begin (validate_state* vs, validate_spec* spec);
+
+/* Checks a chunk of the body, as it arrives */
+void validate_update (validate_state* vs, const void* data, size_t len);
+
+/* Ends the body of a try, returns 1 when it is as expected, 0 otherwise */
+int validate_end (validate_state* vs);
+
+/* CRC32C (Castagnoli) of a buffer, continuing from <crc> */
+uint32_t crc32c (uint32_t crc, const void* data, size_t len);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */
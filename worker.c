@@ -0,0 +1,236 @@
+/*
+ *     worker.c
+ *
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <curl/curl.h>
+
+#include "conf.h"
+#include "run_context.h"
+#include "multi_loop.h"
+#include "worker.h"
+#include "trace.h"
+#include "alloc.h"
+
+/* forward declaration */
+static void* worker_run (void* arg);
+
+
+/*
+* Description - Splits the tries of the run among the workers, gives each of
+*               them a private copy of the client context and a statistics
+*               shard, and starts the worker threads.
+*
+* Input  -      *ctx        - the client context as parsed from the config
+*               *workers    - array of <workers_num> zeroed workers
+*               workers_num - number of the workers to start
+* Return -      On Success - 0, on Error -1
+*/
+int workers_start (client_context* ctx, worker* workers, int workers_num)
+{
+	long cpus_num = sysconf (_SC_NPROCESSORS_ONLN);
+	int capture = 0;
+	int i;
+
+	if (!ctx || !workers || workers_num <= 0) {
+		return -1;
+	}
+
+	/* before any early return, workers_cleanup () closes them all */
+	for (i = 0; i < workers_num; i++) {
+		selfmon_init (&workers[i].mon);
+	}
+
+	for (i = 0; i < ctx->urls_num; i++) {
+		if (ctx->urls[i].log_resp_headers || ctx->urls[i].log_resp_bodies) {
+			capture = 1;
+		}
+	}
+
+	for (i = 0; i < workers_num; i++) {
+		worker* w = &workers[i];
+
+		w->id = i;
+		w->cpu = (ctx->cpu_affinity && cpus_num > 0) ? (int) (i % cpus_num) : -1;
+
+		/* The first (num_tries % workers_num) workers make one try more.
+		   The run time, if any, applies to each worker as a whole, the
+		   rate is split evenly.  */
+		w->ctx = *ctx;
+		w->ctx.num_tries = ctx->num_tries / workers_num +
+			(i < ctx->num_tries % workers_num ? 1 : 0);
+		w->ctx.current_run = 0;
+		w->ctx.handle = NULL;
+		w->ctx.handle_tmpl = NULL;
+		w->ctx.rate = ctx->rate / workers_num;
+		w->ctx.worker_id = i;
+		w->ctx.alloc_warmup = ALLOC_WARMUP_TRIES * (ctx->concurrency > 0 ? ctx->concurrency : 1);
+		rng_seed (&w->ctx.rng, ctx->seed + (uint64_t) i + 1);
+
+		if (stats_shard_init (&w->shard, ctx->hist_precision, ctx->keep_samples) == -1 ||
+				(ctx->report_interval &&
+				 stats_shard_init_interval (&w->shard, ctx->hist_precision) == -1) ||
+				(ctx->urls_num > 1 &&
+				 stats_shard_init_urls (&w->shard, ctx->hist_precision, ctx->urls_num) == -1) ||
+				(ctx->keyspace.keys &&
+				 stats_shard_init_keys (&w->shard, ctx->hist_precision,
+					 keyspace_buckets (&ctx->keyspace)) == -1) ||
+				stats_shard_reserve_samples (&w->shard, w->ctx.num_tries) == -1) {
+			fprintf (stderr, "%s - error: allocation of stats shard %d failed.\n",
+					__func__, i);
+			return -1;
+		}
+		w->ctx.shard = &w->shard;
+		w->ctx.mon = ctx->report_interval ? &w->mon : NULL;
+		w->ctx.trace_ring = ctx->trace_writer ? &ctx->trace_writer->rings[i] : NULL;
+
+		if (capture) {
+			if (capture_ring_open (&w->capture, ctx->dir_log, ctx->run_name, i,
+						ctx->log_ring_size ? ctx->log_ring_size :
+						CAPTURE_RING_SIZE_DEFAULT, ctx->log_sample) == -1) {
+				fprintf (stderr, "%s - error: capture ring of worker %d failed.\n",
+						__func__, i);
+				return -1;
+			}
+			w->ctx.capture = &w->capture;
+		}
+	}
+
+	for (i = 0; i < workers_num; i++) {
+		int err;
+
+		if ((err = pthread_create (&workers[i].thread, NULL, worker_run, &workers[i]))) {
+			fprintf (stderr, "%s - error: pthread_create () failed, errno %d.\n",
+					__func__, err);
+			/* let the started ones finish */
+			workers_join (workers, i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+* Description - Waits for the worker threads to finish
+*
+* Input  -      *workers    - array of the started workers
+*               workers_num - number of the workers
+* Return -      On Success of all the workers - 0, on Error -1
+*/
+int workers_join (worker* workers, int workers_num)
+{
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < workers_num; i++) {
+		pthread_join (workers[i].thread, NULL);
+
+		if (workers[i].ret != 0) {
+			fprintf (stderr, "%s - error: worker %d failed.\n", __func__, i);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+
+/*
+* Description - Tells, whether all the workers have finished their loops
+*
+* Input  -      *workers    - array of the started workers
+*               workers_num - number of the workers
+* Return -      1 when all have finished, 0 otherwise
+*/
+int workers_done (worker* workers, int workers_num)
+{
+	int i;
+
+	for (i = 0; i < workers_num; i++) {
+		if (!atomic_load (&workers[i].done)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+/*
+* Description - Releases statistics shards and capture rings of the workers
+*
+* Input  -      *workers    - array of the workers
+*               workers_num - number of the workers
+*/
+void workers_cleanup (worker* workers, int workers_num)
+{
+	int i;
+
+	for (i = 0; i < workers_num; i++) {
+		stats_shard_free (&workers[i].shard);
+		capture_ring_close (&workers[i].capture);
+		selfmon_close (&workers[i].mon);
+	}
+}
+
+
+/*
+* Description - Thread function of a worker. Pins the thread, if requested,
+*               and runs the serial or the multi loop on the private context.
+*
+* Input  -      *arg - the worker
+* Return -      NULL
+*/
+static void* worker_run (void* arg)
+{
+	worker* w = (worker *) arg;
+
+	if (w->cpu >= 0) {
+		cpu_set_t cpuset;
+		int err;
+
+		CPU_ZERO (&cpuset);
+		CPU_SET (w->cpu, &cpuset);
+
+		if ((err = pthread_setaffinity_np (pthread_self (), sizeof (cpuset), &cpuset))) {
+			fprintf (stderr, "%s - warning: failed to pin worker %d to cpu %d, "
+					"errno %d.\n", __func__, w->id, w->cpu, err);
+		}
+	}
+
+	/* counted from here, the thread counts itself only */
+	if (w->ctx.mon && selfmon_start (w->ctx.mon, w->ctx.perf_counters) == -1 &&
+			w->id == 0) {
+		fprintf (stderr, "%s - warning: perf counters are not available, errno %d; "
+				"see /proc/sys/kernel/perf_event_paranoid.\n", __func__, errno);
+	}
+
+	/* the options common to all the tries are set once, the handles of
+	   the loops are cloned from the template */
+	if (setup_template (&w->ctx) == -1) {
+		w->ret = -1;
+	} else if (w->ctx.concurrency > 0) {
+		/* keep ctx.concurrency tries in flight at a time */
+		w->ret = run_multi_loop (&w->ctx);
+	} else {
+		w->ret = run_serial_loop (&w->ctx);
+	}
+
+	release_template (&w->ctx);
+
+	atomic_store (&w->done, 1);
+
+	return NULL;
+}
+
+/* vim: set ts=4 sw=4 et sts=4:  */
@@ -0,0 +1,61 @@
+/*
+ *     worker.h
+ *
+ */
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "conf.h"
+#include "selfmon.h"
+
+/* A worker thread with its own loop, handles and statistics shard */
+typedef struct worker {
+
+	/* Index of the worker, from 0 up to THREADS - 1 */
+	int id;
+
+	/* CPU the thread is pinned to, -1 when not pinned */
+	int cpu;
+
+	/* The thread running the worker */
+	pthread_t thread;
+
+	/* Private copy of the client context. Keeps own handle, error buffer
+	   and the number of tries of this worker; the urls and their headers
+	   are shared read-only by the workers.  */
+	client_context ctx;
+
+	/* Statistics shard, the histograms recorded by this worker only */
+	stats_shard shard;
+
+	/* Ring file of the captured responses, when logged */
+	capture_ring capture;
+
+	/* Cost of the worker, sampled by the interval reports */
+	selfmon mon;
+
+	/* Result of the worker loop, 0 on success */
+	int ret;
+
+	/* Set, when the worker loop has finished */
+	atomic_int done;
+
+} worker;
+
+/* Splits the tries of <ctx> among <workers_num> workers and starts them */
+int workers_start (client_context* ctx, worker* workers, int workers_num);
+
+/* Waits for the workers to finish, returns -1 when any of them failed */
+int workers_join (worker* workers, int workers_num);
+
+/* Tells, whether all the workers have finished their loops */
+int workers_done (worker* workers, int workers_num);
+
+/* Releases the shards and the private resources of the workers */
+void workers_cleanup (worker* workers, int workers_num);
+
+#endif
+/* vim: set ts=4 sw=4 et sts=4:  */